@@ -0,0 +1,226 @@
+/*
+ * buddy.c -
+ * Binary buddy allocator: blocks are powers of two from 2^MIN_ORDER to
+ * 2^MAX_ORDER bytes, one free list per order, and a block's buddy is found
+ * by flipping the bit of its offset that equals its size.
+ *
+ * Blocks carry no header, so power-of-two requests fit exactly. The order
+ * of every block is kept out of line in a byte map with one entry per
+ * minimum-size block, indexed by offset from the heap base:
+ *
+ *      7   6        0
+ *      ----------------
+ *     | f | order    |     entry of a block's first unit
+ *      ----------------    (f set iff the block is free)
+ *
+ * Entries of units inside a block are zero. The heap is one 2^MAX_ORDER
+ * block of which only a prefix exists: it grows with sbrk up to the end of
+ * the first aligned block of the wanted order, and the alignment gap is
+ * freed as the largest aligned blocks that fit.
+ */
+#include "buddy.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MIN_ORDER 5   /* 32 byte blocks: room for the free-list pointers */
+#define GROW_ORDER 12 /* extend the heap at least a page at a time */
+#define MAX_ORDER 30  /* the heap spans at most 1 GB */
+
+#define FREE_BIT 0x80
+
+// free blocks hold their list links
+struct free_block {
+  struct free_block *next;
+  struct free_block *prev;
+};
+
+static char *heap_base;    // start of the heap
+static size_t heap_top;    // bytes obtained from sbrk so far
+static uint8_t *order_map; // one byte per 2^MIN_ORDER unit
+static struct free_block *free_lists[MAX_ORDER];
+
+static inline size_t UNIT(void *bp) {
+  return (size_t)((char *)bp - heap_base) >> MIN_ORDER;
+}
+
+static inline void *BUDDY(void *bp, int order) {
+  return heap_base + (((char *)bp - heap_base) ^ ((size_t)1 << order));
+}
+
+static void push_free(void *bp, int order) {
+  struct free_block *b = bp;
+
+  b->prev = NULL;
+  b->next = free_lists[order];
+  if (b->next != NULL) {
+    b->next->prev = b;
+  }
+  free_lists[order] = b;
+  order_map[UNIT(bp)] = (uint8_t)(order | FREE_BIT);
+}
+
+static void remove_free(void *bp, int order) {
+  struct free_block *b = bp;
+
+  if (b->prev != NULL) {
+    b->prev->next = b->next;
+  } else {
+    free_lists[order] = b->next;
+  }
+  if (b->next != NULL) {
+    b->next->prev = b->prev;
+  }
+}
+
+//
+// buddy_init - Initialize the allocator
+//
+int buddy_init(void) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t map_size = (size_t)1 << (MAX_ORDER - MIN_ORDER);
+  char *brk = sbrk(0);
+
+  if (order_map == NULL) {
+    order_map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (order_map == MAP_FAILED) {
+      order_map = NULL;
+      return -1;
+    }
+  } else {
+    madvise(order_map, map_size, MADV_DONTNEED); // back to all zero
+  }
+
+  // page-align the heap base; the gap is never used
+  size_t pad = (page - ((uintptr_t)brk & (page - 1))) & (page - 1);
+  if (sbrk((intptr_t)pad) == (void *)-1) {
+    return -1;
+  }
+  heap_base = brk + pad;
+  heap_top = 0;
+  memset(free_lists, 0, sizeof(free_lists));
+  return 0;
+}
+
+//
+// grow - Extend the heap to the end of the first aligned block of order
+// past the current top and return that block (not on any list)
+//
+static char *grow(int order) {
+  size_t top = heap_top;
+  size_t size = (size_t)1 << order;
+  size_t start = (top + size - 1) & ~(size - 1);
+
+  if (start + size > ((size_t)1 << MAX_ORDER)) {
+    return NULL;
+  }
+  if (sbrk((intptr_t)(start + size - top)) != heap_base + top) {
+    return NULL; // out of memory, or someone else moved the break
+  }
+  heap_top = start + size;
+
+  // free the gap as the largest blocks aligned to their own size
+  while (top < start) {
+    int k = __builtin_ctzl(top);
+    while (top + ((size_t)1 << k) > start) {
+      k--;
+    }
+    order_map[top >> MIN_ORDER] = (uint8_t)k;
+    buddy_free(heap_base + top);
+    top += (size_t)1 << k;
+  }
+  return heap_base + start;
+}
+
+//
+// buddy_malloc - Allocate the smallest power-of-two block holding size bytes
+//
+void *buddy_malloc(uint32_t size) {
+  int order = MIN_ORDER, k;
+  char *bp;
+
+  if (size == 0 || size > ((size_t)1 << (MAX_ORDER - 1))) {
+    return NULL;
+  }
+  while (((size_t)1 << order) < size) {
+    order++;
+  }
+
+  // smallest non-empty list at or above order, growing the heap if none
+  for (k = order; k < MAX_ORDER && free_lists[k] == NULL; k++)
+    ;
+  if (k < MAX_ORDER) {
+    bp = (char *)free_lists[k];
+    remove_free(bp, k);
+  } else {
+    k = order > GROW_ORDER ? order : GROW_ORDER;
+    if ((bp = grow(k)) == NULL) {
+      return NULL;
+    }
+  }
+
+  // split down, freeing the upper half at each level
+  while (k > order) {
+    k--;
+    push_free(bp + ((size_t)1 << k), k);
+  }
+  order_map[UNIT(bp)] = (uint8_t)order;
+  return bp;
+}
+
+//
+// buddy_free - Free a block, merging with its buddy while the buddy is a
+// free block of the same order
+//
+void buddy_free(void *ptr) {
+  char *bp = ptr;
+  int order = order_map[UNIT(bp)];
+
+  while (order < MAX_ORDER - 1) {
+    char *buddy = BUDDY(bp, order);
+    if ((size_t)(buddy - heap_base) >= heap_top ||
+        order_map[UNIT(buddy)] != (order | FREE_BIT)) {
+      break;
+    }
+    remove_free(buddy, order);
+    // the upper half's entry becomes an interior unit
+    if (buddy < bp) {
+      order_map[UNIT(bp)] = 0;
+      bp = buddy;
+    } else {
+      order_map[UNIT(buddy)] = 0;
+    }
+    order++;
+  }
+  push_free(bp, order);
+}
+
+//
+// buddy_realloc - Keep the block if the new size still fits its order,
+// otherwise allocate, copy and free
+//
+void *buddy_realloc(void *ptr, uint32_t size) {
+  size_t old_size;
+  void *newp;
+
+  if (ptr == NULL) {
+    return buddy_malloc(size);
+  }
+  if (size == 0) {
+    buddy_free(ptr);
+    return NULL;
+  }
+  old_size = (size_t)1 << order_map[UNIT(ptr)];
+  if (size <= old_size) {
+    return ptr;
+  }
+  if ((newp = buddy_malloc(size)) == NULL) {
+    return NULL;
+  }
+  memcpy(newp, ptr, old_size);
+  buddy_free(ptr);
+  return newp;
+}
@@ -0,0 +1,6 @@
+#include <stdint.h>
+
+extern int buddy_init(void);
+extern void *buddy_malloc(uint32_t size);
+extern void buddy_free(void *ptr);
+extern void *buddy_realloc(void *ptr, uint32_t size);
@@ -1,345 +1,14 @@
 /*
- * Simple allocator based on implicit free lists,
- * first fit placement, and boundary tag coalescing.
- *
- * Each block has header and footer of the form:
- *
- *      31                     3  2  1  0
- *      -----------------------------------
- *     | s  s  s  s  ... s  s  s  0  0  a/f
- *      -----------------------------------
- *
- * where s are the meaningful size bits and a/f is set
- * iff the block is allocated. The list has the following form:
- *
- * begin                                                          end
- * heap                                                           heap
- *  -----------------------------------------------------------------
- * |  pad   | hdr(8:a) | ftr(8:a) | zero or more usr blks | hdr(8:a) |
- *  -----------------------------------------------------------------
- *          |       prologue      |                       | epilogue |
- *          |         block       |                       | block    |
- *
- * The allocated prologue and epilogue blocks are overhead that
- * eliminate edge conditions during coalescing.
+ * implicit.c -
+ * Simple allocator based on an implicit free list, first fit placement,
+ * and boundary tag coalescing, with 4 byte headers and footers. It is the
+ * CS:APP allocator of Figure 9.43, instantiated from policy.h.
  */
-
 #include "implicit.h"
-#include <memory.h>
-#include <stddef.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-
-/////////////////////////////////////////////////////////////////////////////
-// Constants and macros
-//
-// These correspond to the material in Figure 9.43 of the text
-// The macros have been turned into C++ inline functions to
-// make debugging code easier.
-//
-/////////////////////////////////////////////////////////////////////////////
-#define WSIZE 4             /* word size (bytes) */
-#define DSIZE 8             /* doubleword size (bytes) */
-#define CHUNKSIZE (1 << 12) /* initial heap size (bytes) */
-#define OVERHEAD 8          /* overhead of header and footer (bytes) */
-
-static inline int MAX(int x, int y) { return x > y ? x : y; }
-
-//
-// Pack a size and allocated bit into a word
-// We mask of the "alloc" field to insure only
-// the lower bit is used
-//
-static inline uint32_t PACK(uint32_t size, int alloc) {
-  return ((size) | (alloc & 0x1));
-}
-
-//
-// Read and write a word at address p
-//
-static inline uint32_t GET(void *p) { return *(uint32_t *)p; }
-static inline void PUT(void *p, uint32_t val) { *((uint32_t *)p) = val; }
-
-//
-// Read the size and allocated fields from address p
-//
-static inline uint32_t GET_SIZE(void *p) { return GET(p) & ~0x7; }
-
-static inline int GET_ALLOC(void *p) { return GET(p) & 0x1; }
-
-//
-// Given block ptr bp, compute address of its header and footer
-//
-static inline void *HDRP(void *bp) { return ((char *)bp) - WSIZE; }
-static inline void *FTRP(void *bp) {
-  return ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE);
-}
-
-//
-// Given block ptr bp, compute address of next and previous blocks
-//
-static inline void *NEXT_BLKP(void *bp) {
-  return ((char *)(bp) + GET_SIZE(((char *)(bp)-WSIZE)));
-}
-
-static inline void *PREV_BLKP(void *bp) {
-  return ((char *)(bp)-GET_SIZE(((char *)(bp)-DSIZE)));
-}
-
-/////////////////////////////////////////////////////////////////////////////
-//
-// Global Variables
-//
-
-static char *heap_listp; /* pointer to first block */
-
-//
-// function prototypes for internal helper routines
-//
-static void *extend_heap(uint32_t words);
-static void place(void *bp, uint32_t asize);
-static void *find_fit(uint32_t asize);
-static void *coalesce(void *bp);
-static void printblock(void *bp);
-static void checkblock(void *bp);
-
-//
-// implicit_init - Initialize the memory manager
-//
-int implicit_init(void) {
-  // create initial empty heap
-  if ((heap_listp = sbrk(4 * WSIZE)) == (void *)-1)
-    return -1;
-
-  // initialize empty free list
-  PUT(heap_listp, 0);                            // alignment padding
-  PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); // prologue header
-  PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); // prologue footer
-  PUT(heap_listp + (3 * WSIZE), PACK(0, 1));     // epilogue header
-  heap_listp += (2 * WSIZE); // move pointer to first 'real' block
-
-  // extend empty heap with a free block of CHUNKSIZE bytes
-  if (extend_heap(CHUNKSIZE / WSIZE) == NULL) {
-    return -1;
-  }
-  return 0;
-}
-
-//
-// extend_heap - Extend heap with free block and return its block pointer
-//
-static void *extend_heap(uint32_t words) {
-  char *bp;
-  size_t size;
-
-  // allocate even number of words to maintain word size alignment
-  size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
-  if ((long)(bp = sbrk(size)) == -1) {
-    return NULL;
-  }
-
-  // initialize free block header/footer, rewrite new epilogue header
-  PUT(HDRP(bp), PACK(size, 0));         // free block header
-  PUT(FTRP(bp), PACK(size, 0));         // free block footer
-  PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); // new epilogue header
-  return coalesce(bp);
-}
-
-//
-// Practice problem 9.8
-//
-// find_fit - Find a fit for a block with asize bytes
-//
-static void *find_fit(uint32_t asize) {
-  void *bp = heap_listp;
-  while (GET_SIZE(HDRP(bp))) {
-    if ((asize <= GET_SIZE(HDRP(bp))) && !GET_ALLOC(HDRP(bp))) {
-      return bp;
-    }
-    bp = NEXT_BLKP(bp);
-  }
-  return NULL; /* no fit */
-}
-
-//
-// implicit_free - Free a block
-//
-void implicit_free(void *bp) {
-  size_t size = GET_SIZE(HDRP(bp)); // get block size from header
-
-  PUT(HDRP(bp), PACK(size, 0)); // set header pointer of freed block to 0
-  PUT(FTRP(bp), PACK(size, 0)); // set header pointer of freed block to 0
-
-  coalesce(bp); // merge adjacent free blocks
-}
-
-//
-// coalesce - boundary tag coalescing. Return ptr to coalesced block
-//
-static void *coalesce(void *bp) {
-  size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
-  size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
-  size_t size = GET_SIZE(HDRP(bp));
-  if (prev_alloc && next_alloc) {
-    return bp;
-  }
-  /* Case 1 */
-  else if (prev_alloc && !next_alloc) {
-    /* Case 2 */
-    size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
-    PUT(HDRP(bp), PACK(size, 0));
-    PUT(FTRP(bp), PACK(size, 0));
-  } else if (!prev_alloc && next_alloc) {
-    /* Case 3 */
-    size += GET_SIZE(HDRP(PREV_BLKP(bp)));
-    PUT(FTRP(bp), PACK(size, 0));
-    PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
-    bp = PREV_BLKP(bp);
-  } else {
-    /* Case 4 */
-    size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
-    PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
-    PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0));
-    bp = PREV_BLKP(bp);
-  }
-  return bp;
-}
-
-//
-// implicit_malloc - Allocate a block with at least size bytes of payload
-//
-void *implicit_malloc(uint32_t size) {
-  size_t asize;      // adjusted block size
-  size_t extendsize; // amount to extend heap if no fit found
-  char *bp;
-
-  if (size == 0) { // ignore invalid request
-    return NULL;
-  }
-
-  if (size <= DSIZE) { // enforce minimum of 16 bytes
-    asize = 2 * DSIZE;
-  } else { // add in overhead and room for payload
-    asize = DSIZE * ((size + (DSIZE) + (DSIZE - 1)) / DSIZE);
-  }
-
-  // search free list for a fit
-  if ((bp = find_fit(asize)) != NULL) {
-    place(bp, asize);
-    return bp;
-  }
-
-  // if no fit, request more memory
-  extendsize = MAX(asize, CHUNKSIZE);
-  if ((bp = extend_heap(extendsize / WSIZE)) == NULL) {
-    return NULL;
-  }
-  place(bp, asize);
-  return bp;
-}
-
-//
-//
-// Practice problem 9.9
-//
-// place - Place block of asize bytes at start of free block bp
-//         and split if remainder would be at least minimum block size
-//
-static void place(void *bp, uint32_t asize) {
-  size_t csize = GET_SIZE(HDRP(bp));
-
-  if ((csize - asize) >= (2 * DSIZE)) {
-    PUT(HDRP(bp), PACK(asize, 1));
-    PUT(FTRP(bp), PACK(asize, 1));
-    bp = NEXT_BLKP(bp);
-    PUT(HDRP(bp), PACK(csize - asize, 0));
-    PUT(FTRP(bp), PACK(csize - asize, 0));
-  } else {
-    PUT(HDRP(bp), PACK(csize, 1));
-    PUT(FTRP(bp), PACK(csize, 1));
-  }
-}
-
-//
-// implicit_realloc -- implemented for you
-//
-void *implicit_realloc(void *ptr, uint32_t size) {
-  void *newp;
-  uint32_t copySize;
-
-  newp = implicit_malloc(size);
-  if (newp == NULL) {
-    printf("ERROR: implicit_malloc failed in implicit_realloc\n");
-    exit(1);
-  }
-  copySize = GET_SIZE(HDRP(ptr));
-  if (size < copySize) {
-    copySize = size;
-  }
-  memcpy(newp, ptr, copySize);
-  implicit_free(ptr);
-  return newp;
-}
-
-//
-// implicit_checkheap - Check the heap for consistency
-//
-void implicit_checkheap(int verbose) {
-  //
-  // This provided implementation assumes you're using the structure
-  // of the sample solution in the text. If not, omit this code
-  // and provide your own implicit_checkheap
-  //
-  void *bp = heap_listp;
-
-  if (verbose) {
-    printf("Heap (%p):\n", heap_listp);
-  }
-
-  if ((GET_SIZE(HDRP(heap_listp)) != DSIZE) || !GET_ALLOC(HDRP(heap_listp))) {
-    printf("Bad prologue header\n");
-  }
-  checkblock(heap_listp);
-
-  for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-    if (verbose) {
-      printblock(bp);
-    }
-    checkblock(bp);
-  }
-
-  if (verbose) {
-    printblock(bp);
-  }
-
-  if ((GET_SIZE(HDRP(bp)) != 0) || !(GET_ALLOC(HDRP(bp)))) {
-    printf("Bad epilogue header\n");
-  }
-}
-
-static void printblock(void *bp) {
-  uint32_t hsize, halloc, fsize, falloc;
-
-  hsize = GET_SIZE(HDRP(bp));
-  halloc = GET_ALLOC(HDRP(bp));
-  fsize = GET_SIZE(FTRP(bp));
-  falloc = GET_ALLOC(FTRP(bp));
-
-  if (hsize == 0) {
-    printf("%p: EOL\n", bp);
-    return;
-  }
-
-  printf("%p: header: [%d:%c] footer: [%d:%c]\n", bp, (int)hsize,
-         (halloc ? 'a' : 'f'), (int)fsize, (falloc ? 'a' : 'f'));
-}
 
-static void checkblock(void *bp) {
-  if ((uintptr_t)bp % 8) {
-    printf("Error: %p is not doubleword aligned\n", bp);
-  }
-  if (GET(HDRP(bp)) != GET(FTRP(bp))) {
-    printf("Error: header does not match footer\n");
-  }
-}
+#define POLICY_PREFIX implicit
+#define POLICY_LIST LIST_IMPLICIT
+#define POLICY_FIT FIT_FIRST
+#define POLICY_WSIZE 4
+#define POLICY_FOOTERS 1
+#include "policy.h"
@@ -1,11 +1,19 @@
 #include "../mm.h"
+#include "buddy.h"
 #include "explicit.h"
 #include "implicit.h"
+#include "variants.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -13,6 +21,7 @@
 #define MAX_SIZE 1024
 #define UTIL_N 1000
 #define UTIL_OPS 50000
+#define BURST_N 10000
 
 // wrappers for glibc function calls
 static void *glibc_malloc(uint32_t size) { return malloc((size_t)size); }
@@ -74,6 +83,663 @@ static void benchmark_realloc(const char *name, void *(*my_malloc)(uint32_t),
   printf("%s realloc throughput (16 -> 128B): %.6f sec\n", name, end - start);
 }
 
+// reallocs that wander up and down around each buffer's size, as growing
+// and trimming strings do; with "shrink" set, small cuts keep the block
+// whole instead of splitting it only to merge it back on the next grow
+#define RJ_BUFS 1000
+#define RJ_OPS 1000000
+
+static void benchmark_realloc_jitter(const char *name, const char *shrink) {
+  static void *bufs[RJ_BUFS];
+  static uint32_t sizes[RJ_BUFS];
+  struct mm_stats st;
+  double start, end;
+
+  mm_init();
+  mm_config_set("shrink", shrink);
+  srand(1);
+  for (int i = 0; i < RJ_BUFS; i++) {
+    sizes[i] = 256 + rand() % 768;
+    bufs[i] = mm_malloc(sizes[i]);
+  }
+
+  start = now_sec();
+  for (int op = 0; op < RJ_OPS; op++) {
+    int i = rand() % RJ_BUFS;
+    int step = 1 + rand() % 128;
+    if (rand() % 2 && sizes[i] > 256) {
+      sizes[i] -= step;
+    } else if (sizes[i] < 1024) {
+      sizes[i] += step;
+    }
+    bufs[i] = mm_realloc(bufs[i], sizes[i]);
+  }
+  end = now_sec();
+
+  mm_get_stats(&st);
+  printf("%s realloc jitter: %.6f sec, %zu of %d kept in place, heap %zu "
+         "bytes\n",
+         name, end - start, st.realloc_kept, RJ_OPS, st.heap_size);
+  for (int i = 0; i < RJ_BUFS; i++) {
+    mm_free(bufs[i]);
+  }
+  mm_config_set("shrink", "0");
+}
+
+// random malloc/free over UTIL_N slots; utilization is the peak of live
+// requested bytes over the heap the allocator took from sbrk
+static void benchmark_utilization(const char *name, int pow2,
+                                  int (*my_init)(void),
+                                  void *(*my_malloc)(uint32_t),
+                                  void (*my_free)(void *)) {
+  void *ptrs[UTIL_N] = {NULL};
+  uint32_t sizes[UTIL_N] = {0};
+  size_t live = 0, peak_live = 0;
+  char *start = sbrk(0);
+
+  my_init();
+  srand(1);
+  for (int i = 0; i < UTIL_OPS; i++) {
+    int k = rand() % UTIL_N;
+    if (ptrs[k] != NULL) {
+      my_free(ptrs[k]);
+      ptrs[k] = NULL;
+      live -= sizes[k];
+    } else {
+      // power-of-two sizes from 16 bytes up to MAX_SIZE, or any size
+      sizes[k] = pow2 ? 16u << (rand() % 7)
+                      : 1 + (uint32_t)(rand() % MAX_SIZE);
+      ptrs[k] = my_malloc(sizes[k]);
+      live += sizes[k];
+      peak_live = live > peak_live ? live : peak_live;
+    }
+  }
+
+  size_t heap = (size_t)((char *)sbrk(0) - start);
+  printf("%s utilization (%s sizes): %.1f%% (peak live %zu, heap %zu)\n",
+         name, pow2 ? "power-of-two" : "random", 100.0 * peak_live / heap,
+         peak_live, heap);
+  for (int i = 0; i < UTIL_N; i++) {
+    if (ptrs[i] != NULL) {
+      my_free(ptrs[i]);
+    }
+  }
+}
+
+// mixed-lifetime workload: each request allocates scratch objects that die
+// at the end of the request, and some requests leave a long-lived survivor
+// behind in a ring that replaces the oldest survivor
+#define LT_REQUESTS 20000
+#define LT_SCRATCH 8
+#define LT_SURVIVORS 2000
+
+static void benchmark_lifetime(const char *name, int short_hint,
+                               int long_hint) {
+  void *scratch[LT_SCRATCH];
+  void *survivors[LT_SURVIVORS] = {NULL};
+  struct mm_stats st;
+  size_t peak_heap = 0;
+  int next_survivor = 0;
+
+  mm_init();
+  srand(1);
+  for (int r = 0; r < LT_REQUESTS; r++) {
+    for (int i = 0; i < LT_SCRATCH; i++) {
+      scratch[i] = mm_malloc_hint(16 + rand() % 496, short_hint);
+    }
+    if (rand() % 4 == 0) {
+      if (survivors[next_survivor] != NULL) {
+        mm_free(survivors[next_survivor]);
+      }
+      survivors[next_survivor] = mm_malloc_hint(64 + rand() % 192, long_hint);
+      next_survivor = (next_survivor + 1) % LT_SURVIVORS;
+    }
+    for (int i = 0; i < LT_SCRATCH; i++) {
+      mm_free(scratch[i]);
+    }
+    mm_get_stats(&st);
+    peak_heap = st.heap_size > peak_heap ? st.heap_size : peak_heap;
+  }
+
+  mm_get_stats(&st);
+  printf("%s mixed-lifetime heap: peak %zu bytes, live %zu bytes\n", name,
+         peak_heap, st.alloc_bytes);
+
+  for (int i = 0; i < LT_SURVIVORS; i++) {
+    if (survivors[i] != NULL) {
+      mm_free(survivors[i]);
+    }
+  }
+}
+
+// request objects: a header, an index array and a parse buffer per
+// request, allocated together; the buffer is freed once parsed, the rest
+// when the request leaves a ring of CO_LIVE in-flight requests. The buffer
+// goes last so its space can merge with whatever follows it. Reports the
+// time and the mean distance from each header to its index.
+#define CO_REQUESTS 200000
+#define CO_LIVE 1000
+
+static void benchmark_comalloc(const char *name, int together) {
+  static void *live[CO_LIVE][2];
+  uint32_t sizes[3];
+  void *objs[3];
+  double start, end, span = 0;
+
+  mm_init();
+  memset(live, 0, sizeof(live));
+  srand(1);
+  start = now_sec();
+  for (int r = 0; r < CO_REQUESTS; r++) {
+    int slot = r % CO_LIVE;
+    if (live[slot][0] != NULL) {
+      mm_free(live[slot][0]);
+      mm_free(live[slot][1]);
+    }
+    sizes[0] = 48;
+    sizes[1] = 64 + rand() % 192;
+    sizes[2] = 256 + rand() % 768;
+    if (together) {
+      mm_comalloc(3, sizes, objs);
+    } else {
+      for (int i = 0; i < 3; i++) {
+        objs[i] = mm_malloc(sizes[i]);
+      }
+    }
+    mm_free(objs[2]);
+    live[slot][0] = objs[0];
+    live[slot][1] = objs[1];
+    span += labs((char *)objs[1] - (char *)objs[0]);
+  }
+  end = now_sec();
+
+  printf("%s request objects: %f sec, header to index %.0f bytes\n", name,
+         end - start, span / CO_REQUESTS);
+  for (int i = 0; i < CO_LIVE; i++) {
+    mm_free(live[i][0]);
+    mm_free(live[i][1]);
+  }
+}
+
+// small-object churn with a large buffer every WL_LARGE_EVERY requests,
+// kept until the next one arrives. Reports the peak heap and how much of
+// it a trim gives back once the last large buffer is freed.
+#define WL_OPS 200000
+#define WL_SMALL 2000
+#define WL_LARGE_EVERY 500
+
+static void benchmark_wilderness(const char *name, const char *wilderness) {
+  static void *small[WL_SMALL];
+  void *large = NULL;
+  struct mm_stats st;
+  size_t peak = 0, trimmed;
+
+  mm_init();
+  mm_config_set("wilderness", wilderness);
+  memset(small, 0, sizeof(small));
+  srand(1);
+  for (int op = 0; op < WL_OPS; op++) {
+    int i = rand() % WL_SMALL;
+    if (small[i] != NULL) {
+      mm_free(small[i]);
+    }
+    small[i] = mm_malloc(16 + rand() % 240);
+    if (op % WL_LARGE_EVERY == 0) {
+      if (large != NULL) {
+        mm_free(large);
+      }
+      large = mm_malloc(32768 + rand() % 98304);
+    }
+    mm_get_stats(&st);
+    peak = st.heap_size > peak ? st.heap_size : peak;
+  }
+  mm_free(large);
+  trimmed = mm_release_free_memory(MM_RELEASE_TRIM);
+
+  printf("%s wilderness: peak heap %zu bytes, trim released %zu bytes\n",
+         name, peak, trimmed);
+  for (int i = 0; i < WL_SMALL; i++) {
+    if (small[i] != NULL) {
+      mm_free(small[i]);
+    }
+  }
+  mm_config_set("wilderness", "0");
+}
+
+// page faults taken by this process so far
+static long page_faults(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_minflt + ru.ru_majflt;
+}
+
+// malloc/free churn with touched payloads, counting page faults taken in
+// the measured window; a locked pool must take none
+#define RT_POOL (64 << 20)
+
+static void benchmark_page_faults(const char *name, int locked) {
+  void *ptrs[UTIL_N] = {NULL};
+  long faults;
+  double start, end;
+
+  if (locked ? mm_init_locked(RT_POOL) : mm_init()) {
+    printf("%s page faults: skipped (pool setup failed)\n", name);
+    return;
+  }
+  srand(1);
+
+  faults = page_faults();
+  start = now_sec();
+  for (int i = 0; i < UTIL_OPS; i++) {
+    int k = rand() % UTIL_N;
+    if (ptrs[k] != NULL) {
+      mm_free(ptrs[k]);
+      ptrs[k] = NULL;
+    } else {
+      uint32_t size = 1 + rand() % (16 * MAX_SIZE);
+      if ((ptrs[k] = mm_malloc_flags(size, locked ? MM_FAILFAST : 0))) {
+        memset(ptrs[k], 0xa5, size);
+      }
+    }
+  }
+  end = now_sec();
+  faults = page_faults() - faults;
+
+  printf("%s page faults during churn: %ld (%.6f sec)\n", name, faults,
+         end - start);
+  for (int i = 0; i < UTIL_N; i++) {
+    if (ptrs[i] != NULL) {
+      mm_free(ptrs[i]);
+    }
+  }
+}
+
+// allocation burst behind a run of small fragments: each list holds
+// BURST_N 48-byte free blocks below BURST_N 64-byte ones, then BURST_N
+// 48-byte requests (64-byte blocks) arrive. First fit re-scans the
+// fragments for every request; next fit resumes past them.
+static void benchmark_fit(const char *name, const char *fit) {
+  static void *small[BURST_N], *large[BURST_N], *pins[2 * BURST_N];
+  static void *burst[BURST_N];
+  double start, end;
+
+  mm_config_set("fit", fit);
+  mm_init();
+  for (int i = 0; i < BURST_N; i++) {
+    small[i] = mm_malloc(32); // 48-byte block
+    pins[i] = mm_malloc(8);   // keeps the fragments apart
+  }
+  for (int i = 0; i < BURST_N; i++) {
+    large[i] = mm_malloc(48); // 64-byte block
+    pins[BURST_N + i] = mm_malloc(8);
+  }
+  for (int i = 0; i < BURST_N; i++) {
+    mm_free(small[i]);
+    mm_free(large[i]);
+  }
+
+  start = now_sec();
+  for (int i = 0; i < BURST_N; i++) {
+    burst[i] = mm_malloc(48);
+  }
+  end = now_sec();
+
+  struct mm_stats stats;
+  mm_get_stats(&stats);
+  printf("%s burst behind fragments: %.6f sec, heap %zu\n", name,
+         end - start, stats.heap_size);
+  for (int i = 0; i < BURST_N; i++) {
+    mm_free(burst[i]);
+  }
+  for (int i = 0; i < 2 * BURST_N; i++) {
+    mm_free(pins[i]);
+  }
+
+  benchmark_utilization(name, 0, mm_init, mm_malloc, mm_free);
+  mm_config_set("fit", "first");
+}
+
+// cache_miss_counter - Open a counter of this thread's user-space cache
+// misses, or return -1 where perf events are unavailable
+static int cache_miss_counter(void) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// destroy-then-free churn over a small working set, with HOT_COLD cold
+// 256-byte free blocks below it (freed after it was allocated).
+// Address-ordered reuse hands out a cold block each time; the hot buffer
+// hands back the one just read and freed.
+// Cache misses and time cover the first touch of the new blocks.
+#define HOT_COLD 16384
+#define HOT_LIVE 64
+#define HOT_OPS 16384
+#define EVICT_SIZE (32 << 20)
+
+static volatile unsigned teardown_sink; // keeps the teardown reads alive
+
+static void benchmark_hot(const char *name, const char *slots) {
+  static void *cold[HOT_COLD], *pins[HOT_COLD];
+  void *live[HOT_LIVE];
+  long long misses = -1;
+  unsigned sum = 0;
+  double start, end;
+  char *evict;
+  int fd;
+
+  mm_config_set("hot", slots);
+  mm_init();
+  for (int i = 0; i < HOT_COLD; i++) {
+    cold[i] = mm_malloc(240); // 256-byte block
+    pins[i] = mm_malloc(8);
+  }
+  for (int i = 0; i < HOT_LIVE; i++) {
+    live[i] = mm_malloc(240);
+    memset(live[i], i, 240);
+  }
+  for (int i = 0; i < HOT_COLD; i++) {
+    mm_free(cold[i]);
+  }
+
+  // push the cold blocks out of every cache level
+  if ((evict = malloc(EVICT_SIZE)) != NULL) {
+    memset(evict, 1, EVICT_SIZE);
+    free(evict);
+  }
+
+  fd = cache_miss_counter();
+  if (fd != -1) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  srand(1);
+  start = now_sec();
+  for (int i = 0; i < HOT_OPS; i++) {
+    int k = rand() % HOT_LIVE;
+    unsigned char *old = live[k];
+    for (int j = 0; j < 240; j += 8) {
+      sum += old[j]; // tear down the object before freeing it
+    }
+    mm_free(old);
+    live[k] = mm_malloc(240);
+    memset(live[k], i, 240); // first touch
+  }
+  end = now_sec();
+  teardown_sink = sum;
+  if (fd != -1) {
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &misses, sizeof(misses)) != sizeof(misses)) {
+      misses = -1;
+    }
+    close(fd);
+  }
+
+  if (misses >= 0) {
+    printf("%s reuse after free: %.6f sec, %lld cache misses\n", name,
+           end - start, misses);
+  } else {
+    printf("%s reuse after free: %.6f sec, cache misses n/a\n", name,
+           end - start);
+  }
+  for (int i = 0; i < HOT_LIVE; i++) {
+    mm_free(live[i]);
+  }
+  for (int i = 0; i < HOT_COLD; i++) {
+    mm_free(pins[i]);
+  }
+
+  benchmark_utilization(name, 0, mm_init, mm_malloc, mm_free);
+  mm_config_set("hot", "0");
+}
+
+// find_fit probe cost: PROBE_FREE free 80-byte blocks fill one size class
+// and every request is for a larger block of the same class, so each
+// search walks the whole list before it moves on to a higher class
+#define PROBE_FREE 100000
+#define PROBE_OPS 100
+
+static void benchmark_probe(const char *name) {
+  static void *frag[PROBE_FREE], *pins[PROBE_FREE];
+  void *got[PROBE_OPS];
+  double start, end;
+
+  mm_init();
+  for (int i = 0; i < PROBE_FREE; i++) {
+    frag[i] = mm_malloc(64); // 80-byte block
+    pins[i] = mm_malloc(8);
+  }
+  for (int i = 0; i < PROBE_FREE; i++) {
+    mm_free(frag[i]);
+  }
+
+  start = now_sec();
+  for (int i = 0; i < PROBE_OPS; i++) {
+    got[i] = mm_malloc(104); // 120-byte block
+  }
+  end = now_sec();
+
+  printf("%s find_fit over %d free blocks: %.2f ns/probe\n", name,
+         PROBE_FREE, (end - start) * 1e9 / ((double)PROBE_OPS * PROBE_FREE));
+  for (int i = 0; i < PROBE_OPS; i++) {
+    mm_free(got[i]);
+  }
+  for (int i = 0; i < PROBE_FREE; i++) {
+    mm_free(pins[i]);
+  }
+}
+
+// free and list-walk cost on a heap larger than the last-level cache:
+// LARGE_FREE 64-byte blocks between pins of random size are freed from the
+// top down (each goes to the head of its list) and then walked by
+// LARGE_OPS searches that find no fit, so every hop is a cold line.
+// Build with PREFETCH=1 to compare.
+#define LARGE_FREE (1 << 21)
+#define LARGE_OPS 3
+
+static void benchmark_large_heap(const char *name) {
+  static void *frag[LARGE_FREE], *pins[LARGE_FREE];
+  void *got[LARGE_OPS];
+  long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  struct mm_stats st;
+  double start, mid, end;
+
+  mm_init();
+  srand(7);
+  for (int i = 0; i < LARGE_FREE; i++) {
+    frag[i] = mm_malloc(64);
+    pins[i] = mm_malloc(8 + 16 * (uint32_t)(rand() % 8));
+  }
+  mm_get_stats(&st);
+
+  start = now_sec();
+  for (int i = LARGE_FREE - 1; i >= 0; i--) {
+    mm_free(frag[i]);
+  }
+  mid = now_sec();
+  for (int i = 0; i < LARGE_OPS; i++) {
+    got[i] = mm_malloc(104);
+  }
+  end = now_sec();
+
+  printf("%s heap %zu MB (LLC %ld MB): free %.1f ns/op, walk %.2f ns/hop\n",
+         name, st.heap_size >> 20, llc > 0 ? llc >> 20 : 0,
+         (mid - start) * 1e9 / LARGE_FREE,
+         (end - mid) * 1e9 / ((double)LARGE_OPS * LARGE_FREE));
+  for (int i = 0; i < LARGE_OPS; i++) {
+    mm_free(got[i]);
+  }
+  for (int i = 0; i < LARGE_FREE; i++) {
+    mm_free(pins[i]);
+  }
+}
+
+// cache-scratch: SCRATCH_THREADS small objects are allocated back to back
+// (the allocator is single-threaded), then each thread hammers its own.
+// Objects sharing a cache line bounce it between cores.
+#define SCRATCH_THREADS 4
+#define SCRATCH_ITERS 20000000
+
+static void *scratch_worker(void *arg) {
+  volatile char *obj = arg;
+
+  for (int i = 0; i < SCRATCH_ITERS; i++) {
+    for (int k = 0; k < 8; k++) {
+      obj[k]++;
+    }
+  }
+  return NULL;
+}
+
+static void benchmark_cache_scratch(const char *name, int flags) {
+  pthread_t threads[SCRATCH_THREADS];
+  char *objs[SCRATCH_THREADS];
+  int shared = 0;
+  double start, end;
+
+  mm_init();
+  for (int i = 0; i < SCRATCH_THREADS; i++) {
+    objs[i] = mm_malloc_flags(8, flags);
+    if (i > 0 && (uintptr_t)objs[i] / 64 == (uintptr_t)objs[i - 1] / 64) {
+      shared = 1;
+    }
+  }
+
+  start = now_sec();
+  for (int i = 0; i < SCRATCH_THREADS; i++) {
+    pthread_create(&threads[i], NULL, scratch_worker, objs[i]);
+  }
+  for (int i = 0; i < SCRATCH_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  end = now_sec();
+
+  printf("%s cache-scratch, %d threads on %ld cpus: %f sec (%s)\n", name,
+         SCRATCH_THREADS, sysconf(_SC_NPROCESSORS_ONLN), end - start,
+         shared ? "objects share lines" : "one line each");
+  for (int i = 0; i < SCRATCH_THREADS; i++) {
+    mm_free(objs[i]);
+  }
+}
+
+// heap walk: the pause of one mm_heap_walk over WALK_N live blocks against
+// the longest mm_heap_walk_step of WALK_STEP blocks in a full pass
+#define WALK_N 1000000
+#define WALK_STEP 1024
+
+static int count_live(void *ptr, size_t size, int allocated, void *ctx) {
+  (void)ptr;
+  if (allocated) {
+    *(size_t *)ctx += size;
+  }
+  return 0;
+}
+
+static void benchmark_heap_walk(const char *name) {
+  static void *blocks[WALK_N];
+  size_t bytes = 0;
+  double start, end, longest = 0;
+  int done = 0;
+
+  mm_init();
+  for (int i = 0; i < WALK_N; i++) {
+    blocks[i] = mm_malloc(16 + (uint32_t)(i % 64));
+  }
+
+  start = now_sec();
+  mm_heap_walk(count_live, &bytes);
+  end = now_sec();
+  while (!done) {
+    double step = now_sec();
+    done = mm_heap_walk_step(count_live, &bytes, WALK_STEP);
+    if (now_sec() - step > longest) {
+      longest = now_sec() - step;
+    }
+  }
+
+  printf("%s heap walk over %d blocks: full %f sec, longest %d-block step "
+         "%.1f us\n",
+         name, WALK_N, end - start, WALK_STEP, longest * 1e6);
+  for (int i = 0; i < WALK_N; i++) {
+    mm_free(blocks[i]);
+  }
+}
+
+// validation: one mm_validate over VALID_N blocks, every third one free,
+// against the longest and mean mm_validate_step of VALID_STEP blocks
+#define VALID_N 1000000
+#define VALID_STEP 256
+
+static void benchmark_validate(const char *name) {
+  static void *blocks[VALID_N];
+  double start, end, longest = 0, total = 0;
+  int steps = 0, err, r;
+
+  mm_init();
+  for (int i = 0; i < VALID_N; i++) {
+    blocks[i] = mm_malloc(16 + (uint32_t)(i % 64));
+  }
+  // top down, so each block goes to the head of its address-ordered list
+  for (int i = (VALID_N - 1) / 3 * 3; i >= 0; i -= 3) {
+    mm_free(blocks[i]);
+    blocks[i] = NULL;
+  }
+
+  start = now_sec();
+  err = mm_validate(NULL);
+  end = now_sec();
+  do {
+    double step = now_sec();
+    r = mm_validate_step(VALID_STEP, NULL);
+    step = now_sec() - step;
+    total += step;
+    steps++;
+    if (step > longest) {
+      longest = step;
+    }
+  } while (r == MM_VALID_OK);
+
+  printf("%s validate over %d blocks: full %f sec (%s), %d-block step "
+         "longest %.1f us, mean %.1f us\n",
+         name, VALID_N, end - start, err == MM_VALID_OK ? "clean" : "damaged",
+         VALID_STEP, longest * 1e6, total / steps * 1e6);
+  for (int i = 0; i < VALID_N; i++) {
+    if (blocks[i] != NULL) {
+      mm_free(blocks[i]);
+    }
+  }
+}
+
+// allocators instantiated from demo/policy.h, one point of the design
+// space each
+struct variant {
+  const char *name;
+  int (*init)(void);
+  void *(*malloc)(uint32_t);
+  void (*free)(void *);
+  void *(*realloc)(void *, uint32_t);
+};
+
+#define VARIANT(name, prefix)                                               \
+  {name, prefix##_init, prefix##_malloc, prefix##_free, prefix##_realloc}
+
+static const struct variant variants[] = {
+    VARIANT("Explicit address-ordered", explicit_addr),
+    VARIANT("Explicit next-fit", explicit_next),
+    VARIANT("Explicit best-fit", explicit_best),
+    VARIANT("Explicit 4B headers", explicit_w4),
+    VARIANT("Explicit no footers", explicit_nofoot),
+    VARIANT("Segregated address-ordered", seg_addr),
+    VARIANT("Segregated best-fit compact", seg_best_compact),
+};
+
 int main() {
   printf("=== Memory Allocator Benchmark Demo ===\n\n");
 
@@ -86,6 +752,36 @@ int main() {
   mm_init();
   benchmark_malloc_free("Custom", mm_malloc, mm_free);
   benchmark_realloc("Custom", mm_malloc, mm_free, mm_realloc);
+  benchmark_realloc_jitter("Custom (shrink 0%)", "0");
+  benchmark_realloc_jitter("Custom (shrink 25%)", "25");
+  benchmark_lifetime("Custom (no hints)", 0, 0);
+  benchmark_lifetime("Custom (lifetime hints)", MM_SHORT_LIVED, MM_LONG_LIVED);
+  benchmark_comalloc("Custom (3 x mm_malloc)", 0);
+  benchmark_comalloc("Custom (mm_comalloc)", 1);
+  benchmark_wilderness("Custom (any fit)", "0");
+  benchmark_wilderness("Custom (top block last)", "1");
+  benchmark_page_faults("Custom (sbrk heap)", 0);
+  benchmark_page_faults("Custom (locked pool)", 1);
+  benchmark_utilization("Custom", 0, mm_init, mm_malloc, mm_free);
+  benchmark_utilization("Custom", 1, mm_init, mm_malloc, mm_free);
+  benchmark_fit("Custom first-fit", "first");
+  benchmark_fit("Custom next-fit", "next");
+  benchmark_hot("Custom (no hot buffer)", "0");
+  benchmark_hot("Custom (hot buffer)", "8");
+#ifdef MM_SIDE_TABLE
+  benchmark_probe("Custom (leaf vectors)");
+#else
+  benchmark_probe("Custom (in-block links)");
+#endif
+#ifdef MM_PREFETCH
+  benchmark_large_heap("Custom (prefetch)");
+#else
+  benchmark_large_heap("Custom (no prefetch)");
+#endif
+  benchmark_cache_scratch("Custom (packed)", 0);
+  benchmark_cache_scratch("Custom (MM_CACHE_ALIGN)", MM_CACHE_ALIGN);
+  benchmark_heap_walk("Custom");
+  benchmark_validate("Custom");
   putchar('\n');
 
   // Implicit list baseline
@@ -94,6 +790,10 @@ int main() {
   benchmark_malloc_free("Implicit", implicit_malloc, implicit_free);
   benchmark_realloc("Implicit", implicit_malloc, implicit_free,
                     implicit_realloc);
+  benchmark_utilization("Implicit", 0, implicit_init, implicit_malloc,
+                        implicit_free);
+  benchmark_utilization("Implicit", 1, implicit_init, implicit_malloc,
+                        implicit_free);
   putchar('\n');
 
   // Explicit list baseline
@@ -102,6 +802,31 @@ int main() {
   benchmark_malloc_free("Explicit", explicit_malloc, explicit_free);
   benchmark_realloc("Explicit", explicit_malloc, explicit_free,
                     explicit_realloc);
+  benchmark_utilization("Explicit", 0, explicit_init, explicit_malloc,
+                        explicit_free);
+  benchmark_utilization("Explicit", 1, explicit_init, explicit_malloc,
+                        explicit_free);
+  putchar('\n');
+
+  // Binary buddy allocator
+  printf(">>> Testing Buddy allocator <<<\n");
+  buddy_init();
+  benchmark_malloc_free("Buddy", buddy_malloc, buddy_free);
+  benchmark_realloc("Buddy", buddy_malloc, buddy_free, buddy_realloc);
+  benchmark_utilization("Buddy", 0, buddy_init, buddy_malloc, buddy_free);
+  benchmark_utilization("Buddy", 1, buddy_init, buddy_malloc, buddy_free);
+  putchar('\n');
+
+  // Fit-policy variants
+  printf(">>> Testing fit-policy variants <<<\n");
+  for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+    const struct variant *v = &variants[i];
+    v->init();
+    benchmark_malloc_free(v->name, v->malloc, v->free);
+    benchmark_realloc(v->name, v->malloc, v->free, v->realloc);
+    benchmark_utilization(v->name, 0, v->init, v->malloc, v->free);
+    benchmark_utilization(v->name, 1, v->init, v->malloc, v->free);
+  }
   putchar('\n');
 
   // glibc allocator
@@ -0,0 +1,612 @@
+/*
+ * policy.h -
+ * Allocator template. A source file defines the policy parameters below
+ * and then includes this header, which expands into a complete allocator
+ * specialized for them. Every choice is resolved by the preprocessor, so
+ * an instantiation carries no runtime dispatch and no code for the
+ * policies it does not use.
+ *
+ *   POLICY_PREFIX   prefix of the public functions (foo -> foo_malloc)
+ *   POLICY_LIST     LIST_IMPLICIT, LIST_EXPLICIT or LIST_SEGREGATED
+ *   POLICY_INSERT   INSERT_LIFO, INSERT_FIFO or INSERT_ADDRESS
+ *   POLICY_FIT      FIT_FIRST, FIT_BEST or FIT_NEXT (free lists only)
+ *   POLICY_WSIZE    header width in bytes, 4 or 8
+ *   POLICY_FOOTERS  1 to keep footers on allocated blocks, 0 to elide them
+ *
+ * Each block has a header (and, if free or POLICY_FOOTERS, a footer) of
+ * the form:
+ *
+ *      W*8-1                  3  2  1  0
+ *      -----------------------------------
+ *     | s  s  s  s  ... s  s  s  0  p  a/f
+ *      -----------------------------------
+ *
+ * where a/f is set iff the block is allocated and p, used only when
+ * footers are elided, is set iff the previous block is allocated. Free
+ * blocks of the list organizations hold next/prev pointers in their
+ * payload. The heap is laid out as in implicit.c: padding, an allocated
+ * prologue block, the user blocks and a zero-size epilogue header.
+ *
+ * Only one instantiation may appear in a translation unit.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LIST_IMPLICIT 0
+#define LIST_EXPLICIT 1
+#define LIST_SEGREGATED 2
+
+#define INSERT_LIFO 0
+#define INSERT_FIFO 1
+#define INSERT_ADDRESS 2
+
+#define FIT_FIRST 0
+#define FIT_BEST 1
+#define FIT_NEXT 2
+
+#ifndef POLICY_LIST
+#define POLICY_LIST LIST_EXPLICIT
+#endif
+#ifndef POLICY_INSERT
+#define POLICY_INSERT INSERT_LIFO
+#endif
+#ifndef POLICY_FIT
+#define POLICY_FIT FIT_FIRST
+#endif
+#ifndef POLICY_WSIZE
+#define POLICY_WSIZE 8
+#endif
+#ifndef POLICY_FOOTERS
+#define POLICY_FOOTERS 1
+#endif
+
+#if POLICY_FIT == FIT_NEXT && POLICY_LIST == LIST_IMPLICIT
+#error "FIT_NEXT needs a free list to keep its rover on"
+#endif
+
+#if POLICY_WSIZE != 4 && POLICY_WSIZE != 8
+#error "POLICY_WSIZE must be 4 or 8"
+#endif
+
+#define POLICY_CAT2(a, b) a##_##b
+#define POLICY_CAT(a, b) POLICY_CAT2(a, b)
+#define POLICY_FN(name) POLICY_CAT(POLICY_PREFIX, name)
+
+/////////////////////////////////////////////////////////////////////////////
+// Constants and macros
+/////////////////////////////////////////////////////////////////////////////
+#if POLICY_WSIZE == 4
+typedef uint32_t word_t;
+#else
+typedef uint64_t word_t;
+#endif
+
+#define WSIZE POLICY_WSIZE  /* header width (bytes) */
+#define DSIZE (2 * WSIZE)   /* header and footer (bytes) */
+#define CHUNKSIZE (1 << 12) /* initial heap size (bytes) */
+#define ALIGNMENT 8         /* memory alignment factor */
+
+/* overhead of an allocated block (bytes) */
+#define OVERHEAD (POLICY_FOOTERS ? DSIZE : WSIZE)
+
+/* room for the free-list pointers in a free block's payload */
+#define LINKS (POLICY_LIST == LIST_IMPLICIT ? 0 : 2 * sizeof(void *))
+
+/* a free block holds its header, footer and links; never below 16 bytes */
+#define MINBLOCKSIZE                                                         \
+  (ALIGN(DSIZE + LINKS) > 16 ? ALIGN(DSIZE + LINKS) : 16)
+
+#if POLICY_LIST == LIST_SEGREGATED
+#define NUM_LISTS 12 /* list i holds sizes up to MINBLOCKSIZE << i */
+#else
+#define NUM_LISTS 1
+#endif
+
+#define ALLOC_BIT 0x1
+#define PREV_ALLOC_BIT 0x2
+
+static inline size_t ALIGN(size_t size) {
+  return (((size) + (ALIGNMENT - 1)) & ~(size_t)(ALIGNMENT - 1));
+}
+
+static inline size_t MAX(size_t x, size_t y) { return x > y ? x : y; }
+
+//
+// Pack a size and allocated bit into a word
+//
+static inline word_t PACK(size_t size, int alloc) {
+  return (word_t)(size | (size_t)(alloc & 0x1));
+}
+
+//
+// Read and write a header word at address p
+//
+static inline word_t GET(void *p) { return *(word_t *)p; }
+static inline void PUT(void *p, word_t val) { *((word_t *)p) = val; }
+
+//
+// Read the size and allocated fields from address p
+//
+static inline size_t GET_SIZE(void *p) { return GET(p) & ~(word_t)0x7; }
+static inline int GET_ALLOC(void *p) { return (int)(GET(p) & ALLOC_BIT); }
+
+//
+// Given block ptr bp, compute address of its header and footer
+//
+static inline void *HDRP(void *bp) { return ((char *)bp) - WSIZE; }
+static inline void *FTRP(void *bp) {
+  return ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE);
+}
+
+//
+// Given block ptr bp, compute address of next and previous blocks. The
+// previous block is only reachable through its footer, so PREV_BLKP is
+// valid when PREV_IS_ALLOC says the previous block is free
+//
+static inline void *NEXT_BLKP(void *bp) {
+  return ((char *)(bp) + GET_SIZE(((char *)(bp)-WSIZE)));
+}
+
+static inline void *PREV_BLKP(void *bp) {
+  return ((char *)(bp)-GET_SIZE(((char *)(bp)-DSIZE)));
+}
+
+static inline int PREV_IS_ALLOC(void *bp) {
+#if POLICY_FOOTERS
+  return GET_ALLOC((char *)bp - DSIZE);
+#else
+  return (GET(HDRP(bp)) & PREV_ALLOC_BIT) != 0;
+#endif
+}
+
+//
+// set_block - Write the header (and footer, if the block has one) of bp,
+// keeping its previous-allocated bit, and update the next block's bit
+//
+static inline void set_block(void *bp, size_t size, int alloc) {
+  word_t hdr = PACK(size, alloc) | (GET(HDRP(bp)) & PREV_ALLOC_BIT);
+
+  PUT(HDRP(bp), hdr);
+  if (POLICY_FOOTERS || !alloc) {
+    PUT(FTRP(bp), hdr);
+  }
+#if !POLICY_FOOTERS
+  void *next = HDRP(NEXT_BLKP(bp));
+  PUT(next, alloc ? GET(next) | PREV_ALLOC_BIT
+                  : GET(next) & ~(word_t)PREV_ALLOC_BIT);
+#endif
+}
+
+#if POLICY_LIST != LIST_IMPLICIT
+// macros for traversing the free lists
+
+static inline void *NEXT_FREE(void *bp) { return (*(void **)(bp)); }
+static inline void *PREV_FREE(void *bp) { return (*((void **)bp + 1)); }
+
+// setters for free-list pointers
+static inline void SET_NEXT_FREE(void *bp, void *ptr) {
+  *((void **)(bp)) = ptr;
+}
+static inline void SET_PREV_FREE(void *bp, void *ptr) {
+  *((void **)bp + 1) = ptr;
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global Variables
+//
+
+static char *heap_listp; /* pointer to first block */
+#if POLICY_LIST != LIST_IMPLICIT
+static void *free_heads[NUM_LISTS]; // first free block of each list
+static void *free_tails[NUM_LISTS]; // last free block of each list
+#if POLICY_FIT == FIT_NEXT
+static void *free_rovers[NUM_LISTS]; // where each list's next search starts
+#endif
+#endif
+
+//
+// function prototypes for internal helper routines
+//
+static void *extend_heap(size_t words);
+static void place(void *bp, size_t asize);
+static void *find_fit(size_t asize);
+static void *coalesce(void *bp);
+static void printblock(void *bp);
+static void checkblock(void *bp);
+
+#if POLICY_LIST != LIST_IMPLICIT
+//
+// list_index - Map a block size to its free list
+//
+static inline int list_index(size_t size) {
+  int i = 0;
+
+  for (size_t limit = MINBLOCKSIZE; i < NUM_LISTS - 1 && size > limit;
+       limit <<= 1) {
+    i++;
+  }
+  return i;
+}
+
+//
+// link_after - Link free block bp into list i after prev (NULL: at head)
+//
+static void link_after(int i, void *prev, void *bp) {
+  void *next = prev != NULL ? NEXT_FREE(prev) : free_heads[i];
+
+  SET_PREV_FREE(bp, prev);
+  SET_NEXT_FREE(bp, next);
+  if (prev != NULL) {
+    SET_NEXT_FREE(prev, bp);
+  } else {
+    free_heads[i] = bp;
+  }
+  if (next != NULL) {
+    SET_PREV_FREE(next, bp);
+  } else {
+    free_tails[i] = bp;
+  }
+}
+
+//
+// insert_free - Insert free block bp into its list in POLICY_INSERT order
+//
+static void insert_free(void *bp) {
+  int i = list_index(GET_SIZE(HDRP(bp)));
+
+#if POLICY_INSERT == INSERT_LIFO
+  link_after(i, NULL, bp);
+#elif POLICY_INSERT == INSERT_FIFO
+  link_after(i, free_tails[i], bp);
+#else
+  void *prev = NULL;
+  for (void *p = free_heads[i]; p != NULL && p < bp; p = NEXT_FREE(p)) {
+    prev = p;
+  }
+  link_after(i, prev, bp);
+#endif
+}
+
+//
+// delete_free - Unlink free block bp from its list
+//
+static void delete_free(void *bp) {
+  int i = list_index(GET_SIZE(HDRP(bp)));
+  void *prev = PREV_FREE(bp);
+  void *next = NEXT_FREE(bp);
+
+  if (prev != NULL) {
+    SET_NEXT_FREE(prev, next);
+  } else {
+    free_heads[i] = next;
+  }
+  if (next != NULL) {
+    SET_PREV_FREE(next, prev);
+  } else {
+    free_tails[i] = prev;
+  }
+#if POLICY_FIT == FIT_NEXT
+  if (free_rovers[i] == bp) {
+    free_rovers[i] = next;
+  }
+#endif
+}
+#else
+// the implicit list finds free blocks by walking the heap
+static inline void insert_free(void *bp) { (void)bp; }
+static inline void delete_free(void *bp) { (void)bp; }
+#endif
+
+//
+// init - Initialize the memory manager
+//
+int POLICY_FN(init)(void) {
+  // create initial empty heap w/ padding, prologue, epilogue
+  if ((heap_listp = sbrk(4 * WSIZE)) == (void *)-1) {
+    return -1;
+  }
+
+  PUT(heap_listp, 0);                            // alignment padding
+  PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); // prologue header
+  PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); // prologue footer
+  PUT(heap_listp + (3 * WSIZE),
+      PACK(0, 1) | PREV_ALLOC_BIT); // epilogue header
+  heap_listp += DSIZE;              // move pointer to prologue
+
+#if POLICY_LIST != LIST_IMPLICIT
+  memset(free_heads, 0, sizeof(free_heads));
+  memset(free_tails, 0, sizeof(free_tails));
+#endif
+#if POLICY_FIT == FIT_NEXT
+  memset(free_rovers, 0, sizeof(free_rovers));
+#endif
+
+  // extend empty heap with a free block of CHUNKSIZE bytes
+  if (extend_heap(CHUNKSIZE / WSIZE) == NULL) {
+    return -1;
+  }
+  return 0;
+}
+
+//
+// extend_heap - Extend heap with free block and return its block pointer
+//
+static void *extend_heap(size_t words) {
+  char *bp;
+  size_t size;
+
+  // allocate an even number of words to keep blocks aligned
+  size = ALIGN(words * WSIZE);
+  if (size < MINBLOCKSIZE) {
+    size = MINBLOCKSIZE;
+  }
+  if ((long)(bp = sbrk(size)) == -1) {
+    return NULL;
+  }
+
+  // the old epilogue header becomes the free block's header
+  set_block(bp, size, 0);
+  PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); // new epilogue header
+  return coalesce(bp);
+}
+
+//
+// find_fit - Find a fit for a block with asize bytes
+//
+static void *find_fit(size_t asize) {
+#if POLICY_LIST == LIST_IMPLICIT
+  void *best = NULL;
+
+  for (void *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+    size_t size = GET_SIZE(HDRP(bp));
+    if (GET_ALLOC(HDRP(bp)) || size < asize) {
+      continue;
+    }
+    if (POLICY_FIT == FIT_FIRST || size == asize) {
+      return bp;
+    }
+    if (best == NULL || size < GET_SIZE(HDRP(best))) {
+      best = bp;
+    }
+  }
+  return best;
+#elif POLICY_FIT == FIT_NEXT
+  // resume at each list's rover and wrap around to its head
+  for (int i = list_index(asize); i < NUM_LISTS; i++) {
+    void *rover = free_rovers[i];
+
+    for (void *bp = rover != NULL ? rover : free_heads[i]; bp != NULL;
+         bp = NEXT_FREE(bp)) {
+      if (asize <= GET_SIZE(HDRP(bp))) {
+        free_rovers[i] = bp; // place moves it past bp
+        return bp;
+      }
+    }
+    for (void *bp = rover != NULL ? free_heads[i] : NULL; bp != rover;
+         bp = NEXT_FREE(bp)) {
+      if (asize <= GET_SIZE(HDRP(bp))) {
+        free_rovers[i] = bp; // place moves it past bp
+        return bp;
+      }
+    }
+  }
+  return NULL; /* no fit */
+#else
+  // every block in a higher list is larger than any in a lower one, so
+  // the best fit of the first list with a fit is the best overall
+  for (int i = list_index(asize); i < NUM_LISTS; i++) {
+    void *best = NULL;
+
+    for (void *bp = free_heads[i]; bp != NULL; bp = NEXT_FREE(bp)) {
+      size_t size = GET_SIZE(HDRP(bp));
+      if (size < asize) {
+        continue;
+      }
+      if (POLICY_FIT == FIT_FIRST || size == asize) {
+        return bp;
+      }
+      if (best == NULL || size < GET_SIZE(HDRP(best))) {
+        best = bp;
+      }
+    }
+    if (best != NULL) {
+      return best;
+    }
+  }
+  return NULL; /* no fit */
+#endif
+}
+
+//
+// coalesce - boundary tag coalescing. Return ptr to coalesced block, which
+//            is on its free list
+//
+static void *coalesce(void *bp) {
+  int prev_alloc = PREV_IS_ALLOC(bp);
+  int next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+  size_t size = GET_SIZE(HDRP(bp));
+
+  if (!next_alloc) {
+    void *next_bp = NEXT_BLKP(bp);
+    delete_free(next_bp);
+    size += GET_SIZE(HDRP(next_bp));
+  }
+  if (!prev_alloc) {
+    void *prev_bp = PREV_BLKP(bp);
+    delete_free(prev_bp);
+    size += GET_SIZE(HDRP(prev_bp));
+    bp = prev_bp;
+  }
+  set_block(bp, size, 0);
+  insert_free(bp);
+  return bp;
+}
+
+//
+// malloc - Allocate a block with at least size bytes of payload
+//
+void *POLICY_FN(malloc)(uint32_t size) {
+  size_t asize; // adjusted block size
+  char *bp;
+
+  if (size == 0) { // ignore invalid request
+    return NULL;
+  }
+
+  // adjust block size to include overhead + alignment
+  asize = MAX(ALIGN((size_t)size + OVERHEAD), MINBLOCKSIZE);
+
+  // search for a fit, and if none request more memory
+  if ((bp = find_fit(asize)) == NULL &&
+      (bp = extend_heap(MAX(asize, CHUNKSIZE) / WSIZE)) == NULL) {
+    return NULL;
+  }
+  place(bp, asize);
+  return bp;
+}
+
+//
+// place - Place block of asize bytes at start of free block bp
+//         and split if remainder >= MINBLOCKSIZE, insert remainder if split
+//
+static void place(void *bp, size_t asize) {
+  size_t csize = GET_SIZE(HDRP(bp));
+
+  delete_free(bp);
+  if ((csize - asize) >= MINBLOCKSIZE) {
+    set_block(bp, asize, 1);
+    void *newp = NEXT_BLKP(bp);
+    set_block(newp, csize - asize, 0);
+    insert_free(newp);
+#if POLICY_FIT == FIT_NEXT
+    free_rovers[list_index(csize - asize)] = newp; // resume here
+#endif
+  } else { // no splits
+    set_block(bp, csize, 1);
+  }
+}
+
+//
+// free - Free a block
+//
+void POLICY_FN(free)(void *bp) {
+  if (bp == NULL) {
+    return;
+  }
+  coalesce(bp); // rewrites the header as free, merging adjacent free blocks
+}
+
+//
+// realloc - Allocate, copy and free
+//
+void *POLICY_FN(realloc)(void *ptr, uint32_t size) {
+  void *newp;
+  size_t copySize;
+
+  if (ptr == NULL) {
+    return POLICY_FN(malloc)(size);
+  }
+  if (size == 0) {
+    POLICY_FN(free)(ptr);
+    return NULL;
+  }
+  if ((newp = POLICY_FN(malloc)(size)) == NULL) {
+    return NULL;
+  }
+  copySize = GET_SIZE(HDRP(ptr)) - OVERHEAD;
+  if (size < copySize) {
+    copySize = size;
+  }
+  memcpy(newp, ptr, copySize);
+  POLICY_FN(free)(ptr);
+  return newp;
+}
+
+//
+// checkheap - Check the heap for consistency
+//
+void POLICY_FN(checkheap)(int verbose) {
+  void *bp = heap_listp;
+  int prev_alloc = 1;
+  size_t free_blocks = 0;
+
+  if (verbose) {
+    printf("Heap (%p):\n", heap_listp);
+  }
+
+  if ((GET_SIZE(HDRP(heap_listp)) != DSIZE) || !GET_ALLOC(HDRP(heap_listp))) {
+    printf("Bad prologue header\n");
+  }
+  checkblock(heap_listp);
+
+  for (bp = NEXT_BLKP(heap_listp); GET_SIZE(HDRP(bp)) > 0;
+       bp = NEXT_BLKP(bp)) {
+    if (verbose) {
+      printblock(bp);
+    }
+    checkblock(bp);
+    if (PREV_IS_ALLOC(bp) != prev_alloc) {
+      printf("Error: %p disagrees with its predecessor's allocation\n", bp);
+    }
+    if (!prev_alloc && !GET_ALLOC(HDRP(bp))) {
+      printf("Error: %p and its predecessor are both free\n", bp);
+    }
+    prev_alloc = GET_ALLOC(HDRP(bp));
+    free_blocks += !prev_alloc;
+  }
+
+  if (verbose) {
+    printblock(bp);
+  }
+
+  if ((GET_SIZE(HDRP(bp)) != 0) || !(GET_ALLOC(HDRP(bp)))) {
+    printf("Bad epilogue header\n");
+  }
+
+#if POLICY_LIST != LIST_IMPLICIT
+  for (int i = 0; i < NUM_LISTS; i++) {
+    for (void *p = free_heads[i]; p != NULL; p = NEXT_FREE(p)) {
+      if (GET_ALLOC(HDRP(p)) || list_index(GET_SIZE(HDRP(p))) != i) {
+        printf("Error: %p does not belong on free list %d\n", p, i);
+      }
+      free_blocks--;
+    }
+  }
+  if (free_blocks != 0) {
+    printf("Error: free lists and heap disagree on the free blocks\n");
+  }
+#endif
+}
+
+static void printblock(void *bp) {
+  size_t hsize = GET_SIZE(HDRP(bp));
+  int halloc = GET_ALLOC(HDRP(bp));
+
+  if (hsize == 0) {
+    printf("%p: EOL\n", bp);
+    return;
+  }
+  if (!POLICY_FOOTERS && halloc) {
+    printf("%p: header: [%d:a]\n", bp, (int)hsize);
+    return;
+  }
+  printf("%p: header: [%d:%c] footer: [%d:%c]\n", bp, (int)hsize,
+         (halloc ? 'a' : 'f'), (int)GET_SIZE(FTRP(bp)),
+         (GET_ALLOC(FTRP(bp)) ? 'a' : 'f'));
+}
+
+static void checkblock(void *bp) {
+  if ((uintptr_t)bp % ALIGNMENT) {
+    printf("Error: %p is not doubleword aligned\n", bp);
+  }
+  if ((POLICY_FOOTERS || !GET_ALLOC(HDRP(bp))) &&
+      (GET(HDRP(bp)) & ~(word_t)PREV_ALLOC_BIT) !=
+          (GET(FTRP(bp)) & ~(word_t)PREV_ALLOC_BIT)) {
+    printf("Error: header does not match footer\n");
+  }
+}
@@ -0,0 +1,38 @@
+#include <stdint.h>
+
+// allocators instantiated from policy.h, see demo/variants/
+
+extern int explicit_addr_init(void);
+extern void *explicit_addr_malloc(uint32_t size);
+extern void explicit_addr_free(void *ptr);
+extern void *explicit_addr_realloc(void *ptr, uint32_t size);
+
+extern int explicit_next_init(void);
+extern void *explicit_next_malloc(uint32_t size);
+extern void explicit_next_free(void *ptr);
+extern void *explicit_next_realloc(void *ptr, uint32_t size);
+
+extern int explicit_best_init(void);
+extern void *explicit_best_malloc(uint32_t size);
+extern void explicit_best_free(void *ptr);
+extern void *explicit_best_realloc(void *ptr, uint32_t size);
+
+extern int explicit_w4_init(void);
+extern void *explicit_w4_malloc(uint32_t size);
+extern void explicit_w4_free(void *ptr);
+extern void *explicit_w4_realloc(void *ptr, uint32_t size);
+
+extern int explicit_nofoot_init(void);
+extern void *explicit_nofoot_malloc(uint32_t size);
+extern void explicit_nofoot_free(void *ptr);
+extern void *explicit_nofoot_realloc(void *ptr, uint32_t size);
+
+extern int seg_addr_init(void);
+extern void *seg_addr_malloc(uint32_t size);
+extern void seg_addr_free(void *ptr);
+extern void *seg_addr_realloc(void *ptr, uint32_t size);
+
+extern int seg_best_compact_init(void);
+extern void *seg_best_compact_malloc(uint32_t size);
+extern void seg_best_compact_free(void *ptr);
+extern void *seg_best_compact_realloc(void *ptr, uint32_t size);
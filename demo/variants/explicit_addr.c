@@ -0,0 +1,13 @@
+/*
+ * explicit_addr.c -
+ * Explicit list kept in address order, first fit.
+ */
+#include "../variants.h"
+
+#define POLICY_PREFIX explicit_addr
+#define POLICY_LIST LIST_EXPLICIT
+#define POLICY_INSERT INSERT_ADDRESS
+#define POLICY_FIT FIT_FIRST
+#define POLICY_WSIZE 8
+#define POLICY_FOOTERS 1
+#include "../policy.h"
@@ -0,0 +1,13 @@
+/*
+ * explicit_best.c -
+ * Explicit LIFO list, best fit.
+ */
+#include "../variants.h"
+
+#define POLICY_PREFIX explicit_best
+#define POLICY_LIST LIST_EXPLICIT
+#define POLICY_INSERT INSERT_LIFO
+#define POLICY_FIT FIT_BEST
+#define POLICY_WSIZE 8
+#define POLICY_FOOTERS 1
+#include "../policy.h"
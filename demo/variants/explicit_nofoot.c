@@ -0,0 +1,13 @@
+/*
+ * explicit_nofoot.c -
+ * Explicit LIFO list, first fit, no footers on allocated blocks.
+ */
+#include "../variants.h"
+
+#define POLICY_PREFIX explicit_nofoot
+#define POLICY_LIST LIST_EXPLICIT
+#define POLICY_INSERT INSERT_LIFO
+#define POLICY_FIT FIT_FIRST
+#define POLICY_WSIZE 8
+#define POLICY_FOOTERS 0
+#include "../policy.h"
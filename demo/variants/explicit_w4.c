@@ -0,0 +1,13 @@
+/*
+ * explicit_w4.c -
+ * Explicit LIFO list, first fit, 4 byte headers and footers.
+ */
+#include "../variants.h"
+
+#define POLICY_PREFIX explicit_w4
+#define POLICY_LIST LIST_EXPLICIT
+#define POLICY_INSERT INSERT_LIFO
+#define POLICY_FIT FIT_FIRST
+#define POLICY_WSIZE 4
+#define POLICY_FOOTERS 1
+#include "../policy.h"
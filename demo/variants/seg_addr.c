@@ -0,0 +1,16 @@
+/*
+ * seg_addr.c -
+ * Segregated lists in address order, first fit. This is the list
+ * discipline mm.c uses by default, but not mm.c itself: realloc always
+ * allocates, copies and frees, and there are no size class table, hot
+ * buffer or runtime settings.
+ */
+#include "../variants.h"
+
+#define POLICY_PREFIX seg_addr
+#define POLICY_LIST LIST_SEGREGATED
+#define POLICY_INSERT INSERT_ADDRESS
+#define POLICY_FIT FIT_FIRST
+#define POLICY_WSIZE 8
+#define POLICY_FOOTERS 1
+#include "../policy.h"
@@ -0,0 +1,14 @@
+/*
+ * seg_best_compact.c -
+ * Segregated LIFO lists, best fit, 4 byte headers, no footers on
+ * allocated blocks: the smallest per-block overhead in the design space.
+ */
+#include "../variants.h"
+
+#define POLICY_PREFIX seg_best_compact
+#define POLICY_LIST LIST_SEGREGATED
+#define POLICY_INSERT INSERT_LIFO
+#define POLICY_FIT FIT_BEST
+#define POLICY_WSIZE 4
+#define POLICY_FOOTERS 0
+#include "../policy.h"
@@ -4,19 +4,35 @@
  * address-ordered, and MINBLOCKSIZE = 32 bytes.
  */
 #include <assert.h>
+#include <ctype.h>
 #include <memory.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
+#include "mm.h"
+
+// vector kernels for the side table's size scans, picked at run time
+#if defined(MM_SIDE_TABLE) && defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SIZE_SCAN_SIMD
+#endif
+
+// size class bounds generated by tools/sizeclass.out (make CLASSES=...)
+#ifdef MM_CLASSES_HEADER
+#include MM_CLASSES_HEADER
+#endif
+
 /////////////////////////////////////////////////////////////////////////////
 // Constants and macros (64-bit)
 /////////////////////////////////////////////////////////////////////////////
 #define WSIZE 8              /* word size (bytes) */
 #define DSIZE (2 * WSIZE)    /* doubleword size (bytes) */
-#define CHUNKSIZE (1 << 12)  /* initial heap size (bytes) */
+#define CHUNKSIZE (1 << 12)  /* default heap extension step (bytes) */
 #define OVERHEAD (2 * WSIZE) /* overhead of header and footer (bytes) */
 #define ALIGNMENT 8          /* memory alignment factor */
 
@@ -25,11 +41,30 @@
 
 #define NUM_FREE_LISTS 12
 
+/* defrag hints: heap is judged in fixed regions of this many bytes */
+#define REGION_SIZE (1 << 16)
+
+/* blocks up to this size find their list with one table lookup */
+#define CLASS_LUT_MAX 16384
+
+/* hot buffer: recently freed small blocks kept per size class for reuse */
+#define HOT_SLOTS 16
+#define HOT_MAX_SIZE 1024
+
+/* MM_CACHE_ALIGN blocks are laid out in units of this many bytes */
+#define CACHE_LINE 64
+
+/* fit policies */
+#define FIT_FIRST 0
+#define FIT_BEST 1
+#define FIT_NEXT 2
+
 static inline size_t ALIGN(size_t size) {
   return (((size) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1));
 }
 
 static inline size_t MAX(size_t x, size_t y) { return x > y ? x : y; }
+static inline size_t MIN(size_t x, size_t y) { return x < y ? x : y; }
 
 //
 // Pack a size and allocated bit into a word
@@ -46,11 +81,63 @@ static inline uint64_t PACK(uint64_t size, int alloc) {
 static inline uint64_t GET(void *p) { return *(uint64_t *)p; }
 static inline void PUT(void *p, uint64_t val) { *((uint64_t *)p) = val; }
 
+// start loading the cache line at p, so the miss overlaps the work done
+// before p is read. Only with MM_PREFETCH: the lists are address-ordered,
+// so the hardware prefetcher already follows most walks, and the gain
+// measured so far is small.
+static inline void PREFETCH(const void *p) {
+#ifdef MM_PREFETCH
+  __builtin_prefetch(p);
+#else
+  (void)p;
+#endif
+}
+
 //
 // Read the size and allocated fields from address p
 //
-static inline uint64_t GET_SIZE(void *p) { return GET(p) & ~0x7ULL; }
+// Bits 48-55 of an allocated block's tags hold its mm_malloc_tagged tag,
+// so sizes are masked to the low 48 bits
+//
+#define TAG_SHIFT 48
+#define TAG_MASK ((uint64_t)(MM_NUM_TAGS - 1) << TAG_SHIFT)
+#define SIZE_MASK (((1ULL << TAG_SHIFT) - 1) & ~0x7ULL)
+
+static inline uint64_t GET_SIZE(void *p) { return GET(p) & SIZE_MASK; }
 static inline int GET_ALLOC(void *p) { return (int)GET(p) & 0x1ULL; }
+static inline int GET_TAG(void *p) {
+  return (int)((GET(p) & TAG_MASK) >> TAG_SHIFT);
+}
+
+//
+// Allocated blocks owned by a handle carry HANDLE_BIT in both tags; their
+// first payload word holds the handle table index
+//
+#define HANDLE_BIT 0x2ULL
+static inline int GET_HANDLE(void *p) { return (GET(p) & HANDLE_BIT) != 0; }
+
+//
+// Blocks split up front by mm_reserve carry RESERVED_BIT until they are
+// handed out. They are marked allocated, so they never neighbour a free
+// block, but are not accounted and sit on their class's reserve stack.
+//
+#define RESERVED_BIT 0x4ULL
+static inline int GET_RESERVED(void *p) { return (GET(p) & RESERVED_BIT) != 0; }
+
+//
+// MM_CACHE_ALIGN blocks carry ALIGNED_BIT in both tags. The payload starts
+// on a cache line, and the block runs a full line past the rounded-up
+// payload, so its footer and the next header share a line with nothing
+// else. The block just below is an allocated pad of 64-120 bytes that
+// fills the line holding the header. The pad is freed with the block.
+//
+#define ALIGNED_BIT (1ULL << 56)
+static inline int GET_ALIGNED(void *p) { return (GET(p) & ALIGNED_BIT) != 0; }
+
+// ownership bits an allocated block keeps when it is resized in place
+static inline uint64_t GET_EXTRA(void *p) {
+  return GET(p) & (TAG_MASK | HANDLE_BIT);
+}
 
 //
 // Given block ptr bp, compute address of its header and footer
@@ -71,18 +158,101 @@ static inline void *PREV_BLKP(void *bp) {
   return ((char *)(bp)-GET_SIZE(((char *)(bp)-DSIZE)));
 }
 
+//
+// Free lists hold free_refs. By default a free_ref is the free block itself
+// and the links live in its payload. With MM_SIDE_TABLE each list is
+// instead a chain of leaves in a table outside the heap. A leaf holds up
+// to LEAF_N entries in address order, with their sizes and addresses in
+// two contiguous arrays, and a free_ref points at an entry's size. The
+// block keeps only its leaf in its first payload word, next to its header.
+// Fit searches then scan packed sizes instead of touching every free block.
+//
+#ifdef MM_SIDE_TABLE
+#define LEAF_N 62                  /* entries per leaf */
+#define LEAF_BYTES 1024            /* leaves are aligned to their size */
+#define LEAF_CHUNK (1 << 20)       /* leaves per side table reservation */
+// leaves for every free block a heap of heap_bytes can have, see
+// reserve_leaves
+#define LEAVES_FOR(heap_bytes)                                                 \
+  ((heap_bytes) / (2 * MINBLOCKSIZE) + NUM_FREE_LISTS)
+
+struct free_leaf {
+  size_t sizes[LEAF_N];   // block sizes, first so free_refs find the leaf
+  char *blocks[LEAF_N];   // block addresses, ascending
+  struct free_leaf *next; // leaf of higher addresses on the same list
+  struct free_leaf *prev; // leaf of lower addresses on the same list
+  size_t count;           // entries in use, never 0 for a listed leaf
+};
+_Static_assert(sizeof(struct free_leaf) <= LEAF_BYTES, "leaf too large");
+
+// The table is address space reserved in chunks, linked through a header
+// in the first leaf slot of each. extend_heap adds a chunk before the heap
+// could hold more free blocks than there are leaves, so a leaf is always
+// at hand. Chunks are kept for the next mm_init.
+struct leaf_chunk {
+  struct leaf_chunk *next;
+  size_t leaves; // leaf slots, the header's included
+};
+
+typedef size_t *free_ref; // the entry's size in its leaf
+#define NO_FREE ((free_ref)NULL)
+
+static inline struct free_leaf *LEAF_OF(free_ref f) {
+  return (struct free_leaf *)((uintptr_t)f & ~(uintptr_t)(LEAF_BYTES - 1));
+}
+static inline size_t ENTRY(free_ref f) {
+  return (size_t)(f - LEAF_OF(f)->sizes);
+}
+
+static inline free_ref FREE_REF(void *bp) {
+  struct free_leaf *leaf = *(struct free_leaf **)bp;
+  size_t k = 0;
+  while (leaf->blocks[k] != bp) {
+    k++;
+  }
+  return &leaf->sizes[k];
+}
+static inline char *FREE_BP(free_ref f) { return LEAF_OF(f)->blocks[ENTRY(f)]; }
+static inline size_t FREE_SIZE(free_ref f) { return *f; }
+
+static inline free_ref NEXT_FREE(free_ref f) {
+  struct free_leaf *leaf = LEAF_OF(f);
+  if (f + 1 < leaf->sizes + leaf->count) {
+    return f + 1;
+  }
+  return leaf->next != NULL ? leaf->next->sizes : NO_FREE;
+}
+static inline free_ref PREV_FREE(free_ref f) {
+  struct free_leaf *leaf = LEAF_OF(f);
+  if (f > leaf->sizes) {
+    return f - 1;
+  }
+  leaf = leaf->prev;
+  return leaf != NULL ? &leaf->sizes[leaf->count - 1] : NO_FREE;
+}
+#else
+typedef char *free_ref; // the free block
+#define NO_FREE ((free_ref)NULL)
+
+static inline free_ref FREE_REF(void *bp) { return bp; }
+static inline char *FREE_BP(free_ref f) { return f; }
+static inline size_t FREE_SIZE(free_ref f) { return GET_SIZE(HDRP(f)); }
+
 // macros for traversing the free list
 
-static inline void *NEXT_FREE(void *bp) { return (*(void **)(bp)); }
-static inline void *PREV_FREE(char *bp) { return (*(char **)(bp + WSIZE)); }
+static inline free_ref NEXT_FREE(free_ref f) { return (*(free_ref *)(f)); }
+static inline free_ref PREV_FREE(free_ref f) {
+  return (*(free_ref *)(f + WSIZE));
+}
 
 // setters for free-list pointers
-static inline void SET_NEXT_FREE(void *bp, void *ptr) {
-  *((void **)(bp)) = ptr;
+static inline void SET_NEXT_FREE(free_ref f, free_ref next) {
+  *((free_ref *)(f)) = next;
 }
-static inline void SET_PREV_FREE(char *bp, void *ptr) {
-  *((char **)(bp + WSIZE)) = ptr;
+static inline void SET_PREV_FREE(free_ref f, free_ref prev) {
+  *((free_ref *)(f + WSIZE)) = prev;
 }
+#endif
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -90,18 +260,164 @@ static inline void SET_PREV_FREE(char *bp, void *ptr) {
 //
 
 static char *heap_listp;                            /* pointer to first block */
-static void *segregated_free_lists[NUM_FREE_LISTS]; // array of seg lists
+#ifdef MM_SIDE_TABLE
+static struct free_leaf *leaf_heads[NUM_FREE_LISTS]; // lowest leaf per list
+static struct free_leaf *leaf_tails[NUM_FREE_LISTS]; // highest leaf per list
+static struct leaf_chunk *leaf_chunks; // first chunk of the table
+static struct leaf_chunk *leaf_chunk;  // chunk new leaves are cut from
+static size_t leaf_used;               // slots used in leaf_chunk
+static size_t leaf_cap;                // leaves in all chunks
+static struct free_leaf *leaf_unused; // released leaves, linked by next
+#else
+static free_ref segregated_free_lists[NUM_FREE_LISTS]; // array of seg lists
+static free_ref segregated_free_tails[NUM_FREE_LISTS]; // highest per list
+#endif
+static char *segregated_rovers[NUM_FREE_LISTS]; // next-fit resume block
+
+// first and last entries of list i, NO_FREE if it is empty
+#ifdef MM_SIDE_TABLE
+static inline free_ref FIRST_FREE(int i) {
+  return leaf_heads[i] != NULL ? leaf_heads[i]->sizes : NO_FREE;
+}
+static inline free_ref LAST_FREE(int i) {
+  struct free_leaf *leaf = leaf_tails[i];
+  return leaf != NULL ? &leaf->sizes[leaf->count - 1] : NO_FREE;
+}
+#else
+static inline free_ref FIRST_FREE(int i) { return segregated_free_lists[i]; }
+static inline free_ref LAST_FREE(int i) { return segregated_free_tails[i]; }
+#endif
+
+// hot buffer: blocks freed last, newest at the end of each class's array.
+// They stay marked allocated, so nothing coalesces with them, until they
+// are reused or hot_flush frees them for real.
+static void *hot_blocks[NUM_FREE_LISTS][HOT_SLOTS];
+static int hot_count[NUM_FREE_LISTS];
+static int hot_total; // blocks in all hot buffers
+
+// mm_reserve blocks per class, linked through their first payload word
+static void *reserve_heads[NUM_FREE_LISTS];
+static size_t reserve_total; // blocks on all reserve stacks
+static size_t heap_size;   // bytes obtained from mem_sbrk, including tags
+static size_t alloc_bytes; // bytes held by allocated blocks
+static size_t realloc_kept; // mm_realloc calls that left the block as is
+static char *heap_hi;      // block pointer of the epilogue
+
+// allocated bytes per config.region region of the heap, attributed by
+// block pointer and kept beside alloc_bytes, so a region's utilization
+// is one lookup. Like the handle table it lives outside the heap.
+static size_t *region_live;
+static size_t region_cap; // regions region_live covers
+
+// per-tag live payload bytes and object counts (tag 0 is untagged)
+static size_t tag_bytes[MM_NUM_TAGS];
+static size_t tag_count[MM_NUM_TAGS];
+
+// handle table: movable allocations are reached only through these slots
+struct handle_slot {
+  void *bp;       // block pointer, NULL if the slot is unused
+  uint32_t pins;  // outstanding mm_hpin calls, block cannot move while > 0
+  uint32_t next;  // next unused slot (index + 1), 0 ends the chain
+};
+static struct handle_slot *handle_table;
+static uint32_t handle_cap;       // slots in handle_table
+static uint32_t handle_unused;    // head of unused slot chain (index + 1)
+static void *compact_cursor;      // where mm_hcompact resumes its sweep
+static void *walk_cursor;         // where mm_heap_walk_step resumes
+static void *check_cursor;        // where mm_validate_step resumes
+
+// heap quota: limits of 0 mean unlimited. extend_heap compares against
+// limit_check, the lowest limit or armed watermark, so the common case is
+// one compare.
+static size_t hard_limit, soft_limit, limit_check = SIZE_MAX;
+static mm_limit_handler limit_handler;
+static int soft_pressure; // over the soft limit: trim on free
+
+// memory pressure notification
+static mm_pressure_callback pressure_cb;
+static void *pressure_ctx;
+static size_t watermark;     // 0 disables the watermark event
+static int watermark_armed;  // heap is below watermark, next crossing fires
+static int in_pressure;      // callback running, don't re-enter it
+
+// locked pool (mm_init_locked): the heap is carved from a pre-faulted,
+// mlock'd mapping and mem_sbrk just moves pool_brk inside it
+static char *pool_lo, *pool_brk, *pool_hi;
+
+//
+// Runtime configuration, set with mm_config_set or the MM_CONF environment
+// variable ("key:value,key:value"), which is read once at the first init
+//
+static struct {
+  size_t chunk;          // "chunk": heap extension step
+  size_t trim_threshold; // "trim": trim a free top this big on free, 0 = off
+  size_t region;         // "region": defrag region size, a power of two
+  int fit;               // "fit": first, best or next
+  int hot;               // "hot": hot buffer slots per class, 0 = off
+  int shrink;            // "shrink": realloc keeps cuts under this %
+  int wilderness;        // "wilderness": 1 = use the heap top block last
+} config = {CHUNKSIZE, 0, REGION_SIZE, FIT_FIRST, 0, 0, 0};
+
+// "classes": upper bound of each size class but the last, ascending
+#ifndef MM_CLASS_LIMITS
+#define MM_CLASS_LIMITS                                                        \
+  { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384 }
+#endif
+static size_t class_limits[NUM_FREE_LISTS - 1] = MM_CLASS_LIMITS;
+// list index for block sizes up to CLASS_LUT_MAX, by (size - 1) / ALIGNMENT
+static uint8_t class_lut[CLASS_LUT_MAX / ALIGNMENT];
+static int config_loaded; // MM_CONF has been read
 
 //
 // function prototypes for internal helper routines
 //
 static void *extend_heap(size_t words);
+static void *extend_for(size_t asize);
+static char *wilderness(void);
 static void place(void *bp, size_t asize);
 static void *find_fit(size_t asize);
+static void *find_dense_fit(size_t asize);
+static void *find_best_fit(size_t asize, free_ref skip);
+static void *find_next_fit(size_t asize, free_ref skip);
+static void *find_fit_high(size_t asize);
+static void *place_high(void *bp, size_t asize);
+static void *malloc_aligned(uint32_t size, int flags);
+static void *place_aligned(void *bp, size_t asize);
+static int region_is_sparse(void *bp);
+static int grow_regions(size_t heap_bytes);
+static int set_region(size_t region);
+#ifdef MM_SIDE_TABLE
+static void select_size_scan(void);
+static int reserve_leaves(size_t heap_bytes);
+static void reset_leaves(void);
+#endif
 static void *coalesce(void *bp);
 static void delete_free(void *bp);
 static void insert_free(void *bp);
+static void append_free(void *bp);
+static size_t adjust_size(uint32_t size);
 static int get_list_index(size_t size);
+static size_t trim_top(void);
+static size_t purge_free_pages(void);
+static void update_limit_check(void);
+static void *pressure_retry(uint32_t size, int flags);
+static void *mem_sbrk(intptr_t incr);
+static void release_pool(void);
+static int lock_tables(int lock);
+static int init_heap(void);
+static void build_class_lut(void);
+static void rebuild_free_lists(void);
+static void trim_on_free(void);
+static void free_block(void *bp);
+static void *hot_pop(size_t asize);
+static void hot_push(void *bp);
+static void hot_flush(void);
+static int is_hot(void *bp, size_t size);
+static void *reserve_pop(size_t asize);
+static void reserve_flush(void);
+static void block_merged(void *gone, void *into);
+static int validate_block(char *bp);
+static int validate_free(char *bp, size_t size);
 static void printblock(void *bp);
 static void checkblock(void *bp);
 
@@ -109,8 +425,109 @@ static void checkblock(void *bp);
 // mm_init - Initialize the memory manager
 //
 int mm_init(void) {
+  release_pool();
+  return init_heap();
+}
+
+//
+// mm_init_locked - Initialize the memory manager on a pool of reserve
+// bytes that is faulted in and locked up front. The heap never makes a
+// system call to grow afterwards; allocations that don't fit fail.
+//
+int mm_init_locked(size_t reserve) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  char *pool;
+
+  release_pool();
+  reserve = (reserve + page - 1) & ~(page - 1);
+  pool = mmap(NULL, reserve, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (pool == MAP_FAILED) {
+    return -1;
+  }
+  if (mlock(pool, reserve) == -1) {
+    munmap(pool, reserve);
+    return -1;
+  }
+
+  pool_lo = pool_brk = pool;
+  pool_hi = pool + reserve;
+  if (init_heap() == -1) {
+    release_pool();
+    return -1;
+  }
+  return 0;
+}
+
+//
+// release_pool - Unmap the locked pool, if any; back to sbrk
+//
+static void release_pool(void) {
+  if (pool_lo != NULL) {
+    lock_tables(0);
+    munlock(pool_lo, pool_hi - pool_lo);
+    munmap(pool_lo, pool_hi - pool_lo);
+    pool_lo = pool_brk = pool_hi = NULL;
+  }
+}
+
+//
+// lock_tables - mlock (or munlock) region_live and the leaves the locked
+// pool can use, so its allocation path touches only resident memory.
+// Returns 0 on success.
+//
+static int lock_tables(int lock) {
+  int (*op)(const void *, size_t) = lock ? mlock : munlock;
+
+  if (region_live != NULL && op(region_live, region_cap * sizeof(size_t))) {
+    return -1;
+  }
+#ifdef MM_SIDE_TABLE
+  // new_leaf cuts leaves in chunk order, each chunk's first slot its header
+  size_t left = LEAVES_FOR((size_t)(pool_hi - pool_lo));
+  for (struct leaf_chunk *c = leaf_chunks; c != NULL && left > 0;
+       c = c->next) {
+    size_t slots = MIN(c->leaves, left + 1);
+    if (op(c, slots * LEAF_BYTES) == -1) {
+      return -1;
+    }
+    left -= slots - 1;
+  }
+#endif
+  return 0;
+}
+
+//
+// mem_sbrk - sbrk, or the equivalent bump inside the locked pool
+//
+static void *mem_sbrk(intptr_t incr) {
+  char *old = pool_brk;
+
+  if (pool_lo == NULL) {
+    return sbrk(incr);
+  }
+  if (incr > pool_hi - pool_brk || incr < pool_lo - pool_brk) {
+    return (void *)-1;
+  }
+  pool_brk += incr;
+  return old;
+}
+
+//
+// init_heap - Lay out an empty heap and its first free chunk
+//
+static int init_heap(void) {
+  if (!config_loaded) {
+    const char *conf = getenv("MM_CONF");
+    config_loaded = 1;
+    if (conf != NULL) {
+      mm_config_load(conf);
+    }
+  }
+  build_class_lut();
+
   // create initial empty heap w/ padding, prologue, epilogue
-  if ((heap_listp = sbrk(4 * WSIZE)) == (void *)-1)
+  if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
     return -1;
 
   // initialize empty free list
@@ -120,14 +537,57 @@ int mm_init(void) {
   PUT(heap_listp + (3 * WSIZE), PACK(0, 1));     // epilogue header
 
   heap_listp += DSIZE; // move pointer to prologue
+  heap_hi = heap_listp + DSIZE;
+  heap_size = 4 * WSIZE;
+  alloc_bytes = 0;
+  if (region_live != NULL) {
+    memset(region_live, 0, region_cap * sizeof(size_t));
+  }
+  if (pool_hi != NULL && grow_regions(pool_hi - heap_listp) == -1) {
+    return -1; // a locked heap never grows the table later
+  }
+  realloc_kept = 0;
+  memset(tag_bytes, 0, sizeof(tag_bytes));
+  memset(tag_count, 0, sizeof(tag_count));
+
+  if (handle_table != NULL) {
+    munmap(handle_table, handle_cap * sizeof(struct handle_slot));
+  }
+  handle_table = NULL;
+  handle_cap = 0;
+  handle_unused = 0;
+  compact_cursor = heap_listp;
+  walk_cursor = heap_listp;
+  check_cursor = heap_listp;
+  soft_pressure = 0;
+  watermark_armed = watermark != 0;
+  update_limit_check();
 
   // Initialize all segregated free list pointers to NULL
-  for (int i = 0; i < NUM_FREE_LISTS; i++) {
-    segregated_free_lists[i] = NULL;
+#ifdef MM_SIDE_TABLE
+  if (reserve_leaves(pool_hi != NULL ? (size_t)(pool_hi - pool_lo)
+                                     : heap_size) == -1) {
+    return -1;
+  }
+  memset(leaf_heads, 0, sizeof(leaf_heads));
+  memset(leaf_tails, 0, sizeof(leaf_tails));
+  reset_leaves();
+  select_size_scan();
+#else
+  memset(segregated_free_lists, 0, sizeof(segregated_free_lists));
+  memset(segregated_free_tails, 0, sizeof(segregated_free_tails));
+#endif
+  memset(segregated_rovers, 0, sizeof(segregated_rovers));
+  memset(hot_count, 0, sizeof(hot_count));
+  hot_total = 0;
+  memset(reserve_heads, 0, sizeof(reserve_heads));
+  reserve_total = 0;
+  if (pool_hi != NULL && lock_tables(1) == -1) {
+    return -1;
   }
 
-  // extend empty heap with a free block of CHUNKSIZE bytes
-  if (extend_heap(CHUNKSIZE / WSIZE) == NULL) {
+  // extend empty heap with a free block of one chunk
+  if (extend_heap(config.chunk / WSIZE) == NULL) {
     return -1;
   }
   return 0;
@@ -146,246 +606,1404 @@ static void *extend_heap(size_t words) {
   if (size < MINBLOCKSIZE)
     size = MINBLOCKSIZE;
 
-  if ((long)(bp = sbrk(size)) == -1) {
+  if (heap_size + size > limit_check) {
+    if (hard_limit && heap_size + size > hard_limit) {
+      if (limit_handler != NULL) {
+        limit_handler(size);
+      }
+      return NULL;
+    }
+    if (watermark_armed && heap_size + size > watermark) {
+      watermark_armed = 0;
+      update_limit_check();
+      if (pressure_cb != NULL && !in_pressure) {
+        in_pressure = 1;
+        pressure_cb(MM_PRESSURE_WATERMARK, size, pressure_ctx);
+        in_pressure = 0;
+      }
+    }
+    if (soft_limit && heap_size + size > soft_limit) {
+      // past the soft limit: give back what we can before growing further
+      soft_pressure = 1;
+      purge_free_pages();
+    }
+  }
+
+  // a locked pool sized and locked both tables up front: no mmap here
+  if (pool_lo == NULL && grow_regions(heap_hi + size - heap_listp) == -1) {
+    return NULL;
+  }
+#ifdef MM_SIDE_TABLE
+  if (pool_lo == NULL && reserve_leaves(heap_size + size) == -1) {
+    return NULL;
+  }
+#endif
+  if ((long)(bp = mem_sbrk(size)) == -1) {
     return NULL;
   }
+  heap_size += size;
+  heap_hi = bp + size;
 
   // initialize free block header/footer, rewrite new epilogue header
   PUT(HDRP(bp), PACK(size, 0));         // free block header
   PUT(FTRP(bp), PACK(size, 0));         // free block footer
   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); // new epilogue header
 
-  // initialize free list pointers
-  SET_NEXT_FREE(bp, NULL);
-  SET_PREV_FREE(bp, NULL);
-
   return coalesce(bp);
 }
 
 //
-// Practice problem 9.8
-//
-// find_fit - Find a fit for a block with asize bytes
-// loops through se
+// extend_for - Extend the heap for an asize-byte block no free block fits.
+// With the wilderness policy only the part the free top block lacks is
+// added, since the new space merges with it. A pressure callback run by
+// extend_heap may trim that block away first; then the whole request is
+// extended, which holds asize whatever the callback trims.
 //
-static void *find_fit(uint64_t asize) {
-  int index = get_list_index(asize);
+static void *extend_for(size_t asize) {
+  size_t size = asize;
+  char *top, *bp;
 
-  for (int i = index; i < NUM_FREE_LISTS; i++) {
-    void *bp = segregated_free_lists[i];
-    while (bp != NULL) {
-      if (asize <= GET_SIZE(HDRP(bp))) {
-        return bp;
-      }
-      bp = NEXT_FREE(bp);
-    }
+  if (config.wilderness && (top = wilderness()) != NULL &&
+      GET_SIZE(HDRP(top)) < size) {
+    size -= GET_SIZE(HDRP(top));
   }
-  return NULL; /* no fit */
+  bp = extend_heap(MAX(size, config.chunk) / WSIZE);
+  if (bp != NULL && GET_SIZE(HDRP(bp)) < asize) {
+    bp = extend_heap(MAX(asize, config.chunk) / WSIZE);
+  }
+  return bp;
 }
 
-// inserts blocks in address order
-static void insert_free(void *bp) {
-  assert(GET_ALLOC(HDRP(bp)) == 0);
-  size_t size = GET_SIZE(HDRP(bp));
-  int index = get_list_index(size);
+//
+// wilderness - The free block that ends the heap, or NULL if the last
+// block is allocated
+//
+static char *wilderness(void) {
+  char *bp = PREV_BLKP(heap_hi);
 
-  void *list_head = segregated_free_lists[index];
-  void *prev_free = NULL;      // keeps track of previous block
-  void *next_free = list_head; // start at list head
+  return GET_ALLOC(HDRP(bp)) ? NULL : bp;
+}
 
-  // traverse list to find the correct insertion point
-  while (next_free != NULL && (uintptr_t)next_free < (uintptr_t)bp) {
-    prev_free = next_free;
-    next_free = NEXT_FREE(next_free);
-  }
-  // pointers are now set before (prev) and after (next) the insertion point
+#ifdef MM_SIDE_TABLE
+//
+// size_scan - Index of the first of n sizes that is at least asize, or n
+// if there is none. init_heap points it at the widest kernel the CPU runs.
+//
+static size_t size_scan_scalar(const size_t *sizes, size_t n, size_t asize) {
+  size_t k;
 
-  // Case 1: Insert at head of list
-  if (prev_free == NULL) {
-    SET_NEXT_FREE(bp, list_head);
-    SET_PREV_FREE(bp, NULL);
-    if (list_head != NULL) {
-      SET_PREV_FREE(list_head, bp);
-    }
-    segregated_free_lists[index] = bp;
-  } else { // Case 2: Insert in middle or end
-    SET_NEXT_FREE(bp, next_free);
-    SET_PREV_FREE(bp, prev_free);
-    SET_NEXT_FREE(prev_free, bp);
-    if (next_free != NULL) {
-      SET_PREV_FREE(next_free, bp);
-    }
-  }
+  for (k = 0; k < n && sizes[k] < asize; k++)
+    ;
+  return k;
 }
 
-static void delete_free(void *bp) {
-  size_t size = GET_SIZE(HDRP(bp));
-  int index = get_list_index(size);
+#ifdef SIZE_SCAN_SIMD
+// Sizes are below 2^63, so the signed compare size > asize - 1 is
+// size >= asize. The movemask has one bit per size, lowest size first.
 
-  void *prev = PREV_FREE(bp);
-  void *next = NEXT_FREE(bp);
+__attribute__((target("sse4.2"))) static size_t
+size_scan_sse42(const size_t *sizes, size_t n, size_t asize) {
+  __m128i need = _mm_set1_epi64x((long long)(asize - 1));
+  size_t k;
 
-  if (prev != NULL) {
-    SET_NEXT_FREE(prev, next);
-  } else {
-    // bp was head of the list
-    segregated_free_lists[index] = next;
+  for (k = 0; k + 2 <= n; k += 2) {
+    __m128i v = _mm_loadu_si128((const __m128i *)&sizes[k]);
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, need)));
+    if (mask != 0) {
+      return k + (size_t)__builtin_ctz((unsigned)mask);
+    }
   }
+  return k + size_scan_scalar(sizes + k, n - k, asize);
+}
 
-  if (next != NULL) {
-    SET_PREV_FREE(next, prev);
+__attribute__((target("avx2"))) static size_t
+size_scan_avx2(const size_t *sizes, size_t n, size_t asize) {
+  __m256i need = _mm256_set1_epi64x((long long)(asize - 1));
+  size_t k;
+
+  // two compares per iteration, 8 sizes
+  for (k = 0; k + 8 <= n; k += 8) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)&sizes[k]);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)&sizes[k + 4]);
+    __m256i lo_ge = _mm256_cmpgt_epi64(lo, need);
+    __m256i hi_ge = _mm256_cmpgt_epi64(hi, need);
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(lo_ge)) |
+               _mm256_movemask_pd(_mm256_castsi256_pd(hi_ge)) << 4;
+    if (mask != 0) {
+      return k + (size_t)__builtin_ctz((unsigned)mask);
+    }
   }
-
-  // clear pointers for mem ref safety
-  SET_NEXT_FREE(bp, NULL);
-  SET_PREV_FREE(bp, NULL);
+  if (k + 4 <= n) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)&sizes[k]);
+    __m256i ge = _mm256_cmpgt_epi64(v, need);
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(ge));
+    if (mask != 0) {
+      return k + (size_t)__builtin_ctz((unsigned)mask);
+    }
+    k += 4;
+  }
+  return k + size_scan_scalar(sizes + k, n - k, asize);
 }
-
-// helper function for segregated_free_lists
-static int get_list_index(size_t size) {
-  if (size <= 16)
-    return 0;
-  if (size <= 32)
-    return 1;
-  if (size <= 64)
-    return 2;
-  if (size <= 128)
-    return 3;
-  if (size <= 256)
-    return 4;
-  if (size <= 512)
-    return 5;
-  if (size <= 1024)
-    return 6;
-  if (size <= 2048)
-    return 7;
-  if (size <= 4096)
-    return 8;
-  if (size <= 8192)
-    return 9;
-  if (size <= 16384)
-    return 10;
-  return NUM_FREE_LISTS - 1; // Last list for everything larger
+#endif
+
+static size_t (*size_scan)(const size_t *, size_t, size_t) = size_scan_scalar;
+
+// select_size_scan - Pick the size_scan kernel for this CPU
+static void select_size_scan(void) {
+#ifdef SIZE_SCAN_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    size_scan = size_scan_avx2;
+  } else if (__builtin_cpu_supports("sse4.2")) {
+    size_scan = size_scan_sse42;
+  }
+#endif
 }
 
 //
-// coalesce - boundary tag coalescing. Return ptr to coalesced block
+// first_fit - First entry from f up to, not including, end (NO_FREE: the
+// end of the list) whose size is at least asize; scans a leaf at a time
 //
-static void *coalesce(void *bp) {
-  size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
-  size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
-  size_t size = GET_SIZE(HDRP(bp));
+static free_ref first_fit(free_ref f, free_ref end, size_t asize) {
+  while (f != NO_FREE && f != end) {
+    struct free_leaf *leaf = LEAF_OF(f);
+    size_t *stop = leaf->sizes + leaf->count;
+    if (leaf->next != NULL) {
+      PREFETCH(leaf->next->sizes); // loads while this leaf is scanned
+    }
+    if (LEAF_OF(end) == leaf && end > f) {
+      stop = end;
+    }
+    size_t n = (size_t)(stop - f);
+    size_t k = size_scan(f, n, asize);
+    if (k < n) {
+      return f + k;
+    }
+    if (stop == end) {
+      break;
+    }
+    f = leaf->next != NULL ? leaf->next->sizes : NO_FREE;
+  }
+  return NO_FREE;
+}
+#else
+//
+// first_fit - First block from f up to, not including, end (NO_FREE: the
+// end of the list) whose size is at least asize
+//
+static free_ref first_fit(free_ref f, free_ref end, size_t asize) {
+  while (f != NO_FREE && f != end) {
+    free_ref next = NEXT_FREE(f);
+    if (next != NO_FREE) {
+      PREFETCH(HDRP(next)); // size and links of the next hop
+    }
+    if (asize <= FREE_SIZE(f)) {
+      return f;
+    }
+    f = next;
+  }
+  return NO_FREE;
+}
+#endif
 
-  if (prev_alloc && next_alloc) {
-    /* Case 1: both allocated */
-    insert_free(bp);
-    return bp;
-  } else if (prev_alloc && !next_alloc) {
-    /* Case 2: next is free */
-    delete_free(NEXT_BLKP(bp));
-    size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
-    PUT(HDRP(bp), PACK(size, 0));
-    PUT(FTRP(bp), PACK(size, 0));
-    insert_free(bp);
-  } else if (!prev_alloc && next_alloc) {
-    /* Case 3: prev is free */
-    void *prev_bp = PREV_BLKP(bp);
-    delete_free(prev_bp);
-    size += GET_SIZE(HDRP(prev_bp));
-    PUT(FTRP(bp), PACK(size, 0));
-    PUT(HDRP(prev_bp), PACK(size, 0));
-    bp = prev_bp;
-    insert_free(bp);
+//
+// Practice problem 9.8
+//
+// find_fit - Find a fit for a block with asize bytes
+// loops through se
+//
+// With the wilderness policy the free top block is taken only when nothing
+// else fits, so small blocks do not carve up the space large requests and
+// trimming want. Being the highest block it ends its address-ordered list,
+// so the searches skip it by stopping there.
+//
+static void *find_fit(uint64_t asize) {
+  int index = get_list_index(asize);
+  char *top = config.wilderness ? wilderness() : NULL;
+  free_ref skip = top != NULL ? FREE_REF(top) : NO_FREE;
+  void *bp = NULL;
+
+  if (config.fit == FIT_BEST) {
+    bp = find_best_fit(asize, skip);
+  } else if (config.fit == FIT_NEXT) {
+    bp = find_next_fit(asize, skip);
   } else {
-    /* Case 4: both prev and next are free */
-    void *prev_bp = PREV_BLKP(bp);
-    void *next_bp = NEXT_BLKP(bp);
-    delete_free(prev_bp);
-    delete_free(next_bp);
-    size += GET_SIZE(HDRP(prev_bp)) + GET_SIZE(HDRP(next_bp));
-    PUT(HDRP(prev_bp), PACK(size, 0));
-    PUT(FTRP(next_bp), PACK(size, 0));
-    bp = prev_bp;
-    insert_free(bp);
+    for (int i = index; i < NUM_FREE_LISTS && bp == NULL; i++) {
+      free_ref f = first_fit(FIRST_FREE(i), skip, asize);
+      if (f != NO_FREE) {
+        bp = FREE_BP(f);
+      }
+    }
+  }
+  if (bp == NULL && top != NULL && asize <= GET_SIZE(HDRP(top))) {
+    bp = top;
   }
   return bp;
 }
 
 //
-// mm_malloc - Allocate a block with at least size bytes of payload
+// find_best_fit - Find the smallest fit in the first size class that has
+// one; an exact fit ends the search early. Lists stop at skip.
 //
-void *mm_malloc(uint32_t size) {
-  size_t asize;      // adjusted block size
-  size_t extendsize; // amount to extend heap if no fit found
-  char *bp;
+static void *find_best_fit(size_t asize, free_ref skip) {
+  int index = get_list_index(asize);
 
-  if (size == 0) { // ignore invalid request
-    return NULL;
+  for (int i = index; i < NUM_FREE_LISTS; i++) {
+    free_ref best = NO_FREE;
+    size_t best_size = SIZE_MAX;
+    for (free_ref f = FIRST_FREE(i); f != NO_FREE && f != skip;
+         f = NEXT_FREE(f)) {
+      size_t size = FREE_SIZE(f);
+      if (asize <= size && size < best_size) {
+        best = f;
+        best_size = size;
+        if (size == asize) {
+          break;
+        }
+      }
+    }
+    if (best != NO_FREE) {
+      return FREE_BP(best);
+    }
   }
+  return NULL; /* no fit */
+}
 
-  // adjust block size to include overhead + alignment
-  if (size <= (DSIZE - WSIZE)) {
-    asize = MINBLOCKSIZE; // allocate room for free pointers
-  } else {                // add in overhead and room for payload
-    asize = ALIGN(size + OVERHEAD);
-  }
+//
+// find_next_fit - Like find_fit, but each list's search resumes at its
+// rover, where the previous allocation from that list ended, and wraps
+// around to the head. The rover is left on the fit, and delete_free moves
+// a rover off a block leaving its list, so it always points at a listed
+// block or is NULL (start at head). Lists stop at skip.
+//
+static void *find_next_fit(size_t asize, free_ref skip) {
+  int index = get_list_index(asize);
 
-  // search free list for a fit
-  if ((bp = find_fit(asize)) != NULL) {
-    place(bp, asize);
-    return bp;
-  }
+  for (int i = index; i < NUM_FREE_LISTS; i++) {
+    char *rover_bp = segregated_rovers[i];
+    free_ref rover = rover_bp != NULL ? FREE_REF(rover_bp) : NO_FREE;
+    free_ref f =
+        first_fit(rover != NO_FREE ? rover : FIRST_FREE(i), skip, asize);
 
-  // if no fit, request more memory
-  extendsize = MAX(asize, CHUNKSIZE);
-  if ((bp = extend_heap(extendsize / WSIZE)) == NULL) {
-    return NULL;
+    if (f == NO_FREE && rover != NO_FREE) {
+      f = first_fit(FIRST_FREE(i), rover, asize); // wrap around
+    }
+    if (f != NO_FREE) {
+      segregated_rovers[i] = FREE_BP(f); // place moves it past the fit
+      return FREE_BP(f);
+    }
   }
-  place(bp, asize);
-  return bp;
+  return NULL; /* no fit */
 }
 
 //
-// place - Place block of asize bytes at start of free block bp
-//         and split if remainder >= MINBLOCKSIZE, insert remainder if split
+// find_dense_fit - Like find_fit, but skip free blocks that sit in sparse
+// regions so a block being moved out of one does not land in another
 //
-static void place(void *bp, size_t asize) {
-  size_t csize = GET_SIZE(HDRP(bp));
-
-  delete_free(bp); // remove block from free list
+static void *find_dense_fit(size_t asize) {
+  int index = get_list_index(asize);
 
-  if ((csize - asize) >= MINBLOCKSIZE) {
-    // set header/footer
-    PUT(HDRP(bp), PACK(asize, 1));
+  for (int i = index; i < NUM_FREE_LISTS; i++) {
+    for (free_ref f = first_fit(FIRST_FREE(i), NO_FREE, asize); f != NO_FREE;
+         f = first_fit(NEXT_FREE(f), NO_FREE, asize)) {
+      if (!region_is_sparse(FREE_BP(f))) {
+        return FREE_BP(f);
+      }
+    }
+  }
+  return NULL; /* no fit */
+}
+
+//
+// find_fit_high - Find the highest-addressed fit in the first size class
+// that has one, walking each address-ordered list back from its tail
+//
+static void *find_fit_high(size_t asize) {
+  int index = get_list_index(asize);
+
+  for (int i = index; i < NUM_FREE_LISTS; i++) {
+    free_ref f = LAST_FREE(i);
+    while (f != NO_FREE) {
+      if (asize <= FREE_SIZE(f)) {
+        return FREE_BP(f);
+      }
+      f = PREV_FREE(f);
+    }
+  }
+  return NULL; /* no fit */
+}
+
+//
+// region_of - Index of the config.region region holding block pointer bp
+//
+static inline size_t region_of(void *bp) {
+  return (size_t)((char *)bp - heap_listp) >> __builtin_ctzll(config.region);
+}
+
+//
+// account - Add delta bytes held by allocated block bp (negative when they
+// are given up) to alloc_bytes and to the count of bp's region
+//
+static inline void account(void *bp, ptrdiff_t delta) {
+  alloc_bytes += delta;
+  region_live[region_of(bp)] += delta;
+}
+
+//
+// region_is_sparse - True if the config.region region holding bp is less
+// utilized than the heap as a whole. Blocks count toward the region their
+// block pointer falls in, so a region's bytes are those of its span.
+//
+static int region_is_sparse(void *bp) {
+  size_t r = region_of(bp);
+  size_t lo = r << __builtin_ctzll(config.region);
+  size_t span = MIN(config.region, (size_t)(heap_hi - heap_listp) - lo);
+
+  // region_live / span < alloc_bytes / heap_size
+  return (uint64_t)region_live[r] * heap_size < (uint64_t)alloc_bytes * span;
+}
+
+//
+// grow_regions - Make region_live cover a heap of heap_bytes bytes from the
+// prologue. Returns 0 on success.
+//
+static int grow_regions(size_t heap_bytes) {
+  size_t need = (heap_bytes >> __builtin_ctzll(config.region)) + 1;
+  size_t cap = region_cap ? region_cap : 64;
+  size_t *table;
+
+  if (need <= region_cap) {
+    return 0;
+  }
+  while (cap < need) {
+    cap *= 2;
+  }
+  table = mmap(NULL, cap * sizeof(size_t), PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (table == MAP_FAILED) {
+    return -1;
+  }
+  if (region_live != NULL) {
+    memcpy(table, region_live, region_cap * sizeof(size_t));
+    munmap(region_live, region_cap * sizeof(size_t));
+  }
+  region_live = table;
+  region_cap = cap;
+  return 0;
+}
+
+//
+// set_region - Switch to regions of the given size, recounting a live heap
+// into a new table. Returns 0 on success.
+//
+static int set_region(size_t region) {
+  size_t *old_live = region_live, old_cap = region_cap;
+  size_t old_region = config.region;
+
+  config.region = region;
+  if (heap_listp == NULL) {
+    return 0;
+  }
+  hot_flush(); // hot blocks look allocated but are not counted
+  region_live = NULL;
+  region_cap = 0;
+  if (grow_regions((pool_hi != NULL ? pool_hi : heap_hi) - heap_listp) == -1) {
+    region_live = old_live;
+    region_cap = old_cap;
+    config.region = old_region;
+    return -1;
+  }
+  if (old_live != NULL) {
+    munmap(old_live, old_cap * sizeof(size_t));
+  }
+  for (char *bp = NEXT_BLKP(heap_listp); bp != heap_hi; bp = NEXT_BLKP(bp)) {
+    if (GET_ALLOC(HDRP(bp)) && !GET_RESERVED(HDRP(bp))) {
+      region_live[region_of(bp)] += GET_SIZE(HDRP(bp));
+    }
+  }
+  return pool_lo != NULL ? lock_tables(1) : 0;
+}
+
+#ifdef MM_SIDE_TABLE
+//
+// reserve_leaves - Make sure the table holds a leaf for every free block a
+// heap of heap_bytes bytes can have. Listed leaves are never empty and
+// free blocks are never adjacent, so that is one per two minimum blocks.
+// Returns 0 on success.
+//
+static int reserve_leaves(size_t heap_bytes) {
+  size_t need = LEAVES_FOR(heap_bytes);
+  struct leaf_chunk **link = &leaf_chunks;
+
+  while (leaf_cap < need) {
+    // pages fault in as used. mmap returns page-aligned memory, so every
+    // leaf is LEAF_BYTES aligned.
+    size_t leaves = MAX(LEAF_CHUNK, need - leaf_cap + 1);
+    struct leaf_chunk *c =
+        mmap(NULL, leaves * LEAF_BYTES, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (c == MAP_FAILED) {
+      return -1;
+    }
+    c->next = NULL;
+    c->leaves = leaves;
+    while (*link != NULL) {
+      link = &(*link)->next;
+    }
+    *link = c;
+    leaf_cap += leaves - 1;
+  }
+  return 0;
+}
+
+// reset_leaves - Forget every leaf; the next is cut from the first chunk
+static void reset_leaves(void) {
+  leaf_chunk = leaf_chunks;
+  leaf_used = 1;
+  leaf_unused = NULL;
+}
+
+// new_leaf - Take an empty leaf from the released chain or the table
+static struct free_leaf *new_leaf(void) {
+  struct free_leaf *leaf;
+
+  if (leaf_unused != NULL) {
+    leaf = leaf_unused;
+    leaf_unused = leaf->next;
+  } else {
+    if (leaf_used == leaf_chunk->leaves) {
+      leaf_chunk = leaf_chunk->next;
+      leaf_used = 1;
+    }
+    leaf = (struct free_leaf *)((char *)leaf_chunk + leaf_used++ * LEAF_BYTES);
+  }
+  leaf->count = 0;
+  return leaf;
+}
+
+// link_leaf - Put leaf on list index after prev, or at the head if NULL
+static void link_leaf(int index, struct free_leaf *leaf,
+                      struct free_leaf *prev) {
+  leaf->prev = prev;
+  leaf->next = prev != NULL ? prev->next : leaf_heads[index];
+  if (prev != NULL) {
+    prev->next = leaf;
+  } else {
+    leaf_heads[index] = leaf;
+  }
+  if (leaf->next != NULL) {
+    leaf->next->prev = leaf;
+  } else {
+    leaf_tails[index] = leaf;
+  }
+}
+
+// unlink_leaf - Take leaf off list index and put it on the released chain
+static void unlink_leaf(int index, struct free_leaf *leaf) {
+  if (leaf->prev != NULL) {
+    leaf->prev->next = leaf->next;
+  } else {
+    leaf_heads[index] = leaf->next;
+  }
+  if (leaf->next != NULL) {
+    leaf->next->prev = leaf->prev;
+  } else {
+    leaf_tails[index] = leaf->prev;
+  }
+  leaf->next = leaf_unused;
+  leaf_unused = leaf;
+}
+
+// move_entries - Move n entries of src starting at k to dst at j; blocks
+// that change leaves are pointed at dst
+static void move_entries(struct free_leaf *dst, size_t j,
+                         struct free_leaf *src, size_t k, size_t n) {
+  memmove(&dst->sizes[j], &src->sizes[k], n * sizeof(size_t));
+  memmove(&dst->blocks[j], &src->blocks[k], n * sizeof(char *));
+  if (dst != src) {
+    for (size_t i = j; i < j + n; i++) {
+      *(struct free_leaf **)dst->blocks[i] = dst;
+    }
+  }
+}
+
+// inserts blocks in address order, splitting a full leaf in halves
+static void insert_free(void *bp) {
+  assert(GET_ALLOC(HDRP(bp)) == 0);
+  size_t size = GET_SIZE(HDRP(bp));
+  int index = get_list_index(size);
+  struct free_leaf *leaf = leaf_heads[index];
+  size_t k;
+
+  if (leaf == NULL) {
+    leaf = new_leaf();
+    link_leaf(index, leaf, NULL);
+  }
+  // the first leaf reaching past bp, or the last one
+  while (leaf->next != NULL &&
+         (uintptr_t)leaf->blocks[leaf->count - 1] < (uintptr_t)bp) {
+    leaf = leaf->next;
+    if (leaf->next != NULL) {
+      PREFETCH(&leaf->next->count); // count and last block of the next hop
+    }
+  }
+  if (leaf->count == LEAF_N) {
+    struct free_leaf *upper = new_leaf();
+    link_leaf(index, upper, leaf);
+    move_entries(upper, 0, leaf, LEAF_N / 2, LEAF_N - LEAF_N / 2);
+    upper->count = LEAF_N - LEAF_N / 2;
+    leaf->count = LEAF_N / 2;
+    if ((uintptr_t)leaf->blocks[leaf->count - 1] < (uintptr_t)bp) {
+      leaf = upper;
+    }
+  }
+
+  for (k = 0; k < leaf->count && (uintptr_t)leaf->blocks[k] < (uintptr_t)bp;
+       k++)
+    ;
+  move_entries(leaf, k + 1, leaf, k, leaf->count - k);
+  leaf->sizes[k] = size;
+  leaf->blocks[k] = bp;
+  leaf->count++;
+  *(struct free_leaf **)bp = leaf;
+}
+
+// appends bp to its list; bp must lie above every block already on it
+static void append_free(void *bp) {
+  size_t size = GET_SIZE(HDRP(bp));
+  int index = get_list_index(size);
+  struct free_leaf *leaf = leaf_tails[index];
+
+  if (leaf == NULL || leaf->count == LEAF_N) {
+    leaf = new_leaf();
+    link_leaf(index, leaf, leaf_tails[index]);
+  }
+  leaf->sizes[leaf->count] = size;
+  leaf->blocks[leaf->count] = bp;
+  leaf->count++;
+  *(struct free_leaf **)bp = leaf;
+}
+
+// removes bp from its list; a leaf left empty is released, and one that
+// fits in half a leaf together with a neighbour is merged into it
+static void delete_free(void *bp) {
+  size_t size = GET_SIZE(HDRP(bp));
+  int index = get_list_index(size);
+  free_ref f = FREE_REF(bp);
+  struct free_leaf *leaf = LEAF_OF(f);
+  size_t k = ENTRY(f);
+
+  if (segregated_rovers[index] == bp) {
+    free_ref next = NEXT_FREE(f);
+    segregated_rovers[index] = next != NO_FREE ? FREE_BP(next) : NULL;
+  }
+
+  leaf->count--;
+  move_entries(leaf, k, leaf, k + 1, leaf->count - k);
+  if (leaf->count == 0) {
+    unlink_leaf(index, leaf);
+    return;
+  }
+  if (leaf->prev != NULL && leaf->prev->count + leaf->count <= LEAF_N / 2) {
+    leaf = leaf->prev;
+  }
+  struct free_leaf *next = leaf->next;
+  if (next != NULL && leaf->count + next->count <= LEAF_N / 2) {
+    move_entries(leaf, leaf->count, next, 0, next->count);
+    leaf->count += next->count;
+    unlink_leaf(index, next);
+  }
+}
+#else
+// inserts blocks in address order
+static void insert_free(void *bp) {
+  assert(GET_ALLOC(HDRP(bp)) == 0);
+  size_t size = GET_SIZE(HDRP(bp));
+  int index = get_list_index(size);
+  free_ref f = bp;
+
+  free_ref list_head = segregated_free_lists[index];
+  free_ref prev_free = NO_FREE;   // keeps track of previous block
+  free_ref next_free = list_head; // start at list head
+
+  // traverse list to find the correct insertion point
+  while (next_free != NO_FREE && (uintptr_t)next_free < (uintptr_t)bp) {
+    prev_free = next_free;
+    next_free = NEXT_FREE(next_free);
+    PREFETCH(next_free); // links of the hop after
+  }
+  // pointers are now set before (prev) and after (next) the insertion point
+
+  if (next_free == NO_FREE) {
+    segregated_free_tails[index] = f;
+  }
+
+  // Case 1: Insert at head of list
+  if (prev_free == NO_FREE) {
+    SET_NEXT_FREE(f, list_head);
+    SET_PREV_FREE(f, NO_FREE);
+    if (list_head != NO_FREE) {
+      SET_PREV_FREE(list_head, f);
+    }
+    segregated_free_lists[index] = f;
+  } else { // Case 2: Insert in middle or end
+    SET_NEXT_FREE(f, next_free);
+    SET_PREV_FREE(f, prev_free);
+    SET_NEXT_FREE(prev_free, f);
+    if (next_free != NO_FREE) {
+      SET_PREV_FREE(next_free, f);
+    }
+  }
+}
+
+// appends bp to its list; bp must lie above every block already on it
+static void append_free(void *bp) {
+  int index = get_list_index(GET_SIZE(HDRP(bp)));
+  free_ref tail = segregated_free_tails[index];
+  free_ref f = bp;
+
+  SET_NEXT_FREE(f, NO_FREE);
+  SET_PREV_FREE(f, tail);
+  if (tail != NO_FREE) {
+    SET_NEXT_FREE(tail, f);
+  } else {
+    segregated_free_lists[index] = f;
+  }
+  segregated_free_tails[index] = f;
+}
+
+static void delete_free(void *bp) {
+  size_t size = GET_SIZE(HDRP(bp));
+  int index = get_list_index(size);
+  free_ref f = bp;
+
+  free_ref prev = PREV_FREE(f);
+  free_ref next = NEXT_FREE(f);
+
+  if (prev != NO_FREE) {
+    SET_NEXT_FREE(prev, next);
+  } else {
+    // bp was head of the list
+    segregated_free_lists[index] = next;
+  }
+
+  if (next != NO_FREE) {
+    SET_PREV_FREE(next, prev);
+  } else {
+    // bp was tail of the list
+    segregated_free_tails[index] = prev;
+  }
+
+  if (segregated_rovers[index] == bp) {
+    segregated_rovers[index] = next;
+  }
+
+  // clear pointers for mem ref safety
+  SET_NEXT_FREE(f, NO_FREE);
+  SET_PREV_FREE(f, NO_FREE);
+}
+#endif
+
+// helper function for segregated_free_lists
+static int get_list_index(size_t size) {
+  if (size <= CLASS_LUT_MAX) {
+    return class_lut[(size - 1) / ALIGNMENT];
+  }
+  for (int i = 0; i < NUM_FREE_LISTS - 1; i++) {
+    if (size <= class_limits[i]) {
+      return i;
+    }
+  }
+  return NUM_FREE_LISTS - 1; // Last list for everything larger
+}
+
+// rebuild_free_lists - Re-file every free block after the size classes
+// changed; the heap walk is in address order, so appending keeps it
+static void rebuild_free_lists(void) {
+#ifdef MM_SIDE_TABLE
+  memset(leaf_heads, 0, sizeof(leaf_heads));
+  memset(leaf_tails, 0, sizeof(leaf_tails));
+  reset_leaves();
+#else
+  memset(segregated_free_lists, 0, sizeof(segregated_free_lists));
+  memset(segregated_free_tails, 0, sizeof(segregated_free_tails));
+#endif
+  memset(segregated_rovers, 0, sizeof(segregated_rovers));
+  for (char *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+    if (!GET_ALLOC(HDRP(bp))) {
+      append_free(bp);
+    }
+  }
+}
+
+// build_class_lut - Precompute get_list_index for small sizes
+static void build_class_lut(void) {
+  int index = 0;
+
+  for (size_t i = 0; i < CLASS_LUT_MAX / ALIGNMENT; i++) {
+    size_t size = (i + 1) * ALIGNMENT;
+    while (index < NUM_FREE_LISTS - 1 && size > class_limits[index]) {
+      index++;
+    }
+    class_lut[i] = (uint8_t)index;
+  }
+}
+
+//
+// trim_top - Return the free block next to the epilogue to the system.
+// Only possible while our epilogue is still the program break.
+//
+static size_t trim_top(void) {
+  void *last = PREV_BLKP(heap_hi);
+  size_t size;
+
+  if (last == heap_listp || GET_ALLOC(HDRP(last)) || mem_sbrk(0) != heap_hi) {
+    return 0;
+  }
+  size = GET_SIZE(HDRP(last));
+  delete_free(last);
+  if (mem_sbrk(-(intptr_t)size) == (void *)-1) {
+    insert_free(last);
+    return 0;
+  }
+  PUT(HDRP(last), PACK(0, 1)); // new epilogue header
+  heap_hi = last;
+  heap_size -= size;
+  if (watermark && !watermark_armed && heap_size <= watermark) {
+    watermark_armed = 1;
+    update_limit_check();
+  }
+  if ((char *)compact_cursor >= heap_hi) {
+    compact_cursor = heap_hi;
+  }
+  if ((char *)walk_cursor >= heap_hi) {
+    walk_cursor = heap_hi;
+  }
+  if ((char *)check_cursor >= heap_hi) {
+    check_cursor = heap_hi;
+  }
+  return size;
+}
+
+//
+// purge_free_pages - Hand the whole pages inside free blocks back to the
+// kernel. The tags and free-list pointers at either end stay resident.
+//
+static size_t purge_free_pages(void) {
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  size_t purged = 0;
+
+  if (pool_lo != NULL) {
+    return 0; // locked pool pages must stay resident
+  }
+
+  for (int i = 0; i < NUM_FREE_LISTS; i++) {
+    for (free_ref f = FIRST_FREE(i); f != NO_FREE; f = NEXT_FREE(f)) {
+      char *bp = FREE_BP(f);
+      uintptr_t lo = ((uintptr_t)bp + DSIZE + page - 1) & ~(page - 1);
+      uintptr_t hi = (uintptr_t)FTRP(bp) & ~(page - 1);
+      if (lo < hi && madvise((void *)lo, hi - lo, MADV_DONTNEED) == 0) {
+        purged += hi - lo;
+      }
+    }
+  }
+  return purged;
+}
+
+//
+// trim_on_free - Trim the free heap top once it reaches the trim threshold,
+// or a chunk while over the soft limit
+//
+static void trim_on_free(void) {
+  void *last = PREV_BLKP(heap_hi);
+  size_t threshold = config.trim_threshold ? config.trim_threshold
+                                           : config.chunk;
+
+  if (!GET_ALLOC(HDRP(last)) && GET_SIZE(HDRP(last)) >= threshold) {
+    trim_top();
+  }
+  if (heap_size <= soft_limit) {
+    soft_pressure = 0;
+  }
+}
+
+//
+// block_merged - Block gone has just been absorbed into block into; move
+// any sweep cursor that was parked on it so it stays on a block boundary
+//
+static void block_merged(void *gone, void *into) {
+  if (compact_cursor == gone) {
+    compact_cursor = into;
+  }
+  if (walk_cursor == gone) {
+    walk_cursor = into;
+  }
+  if (check_cursor == gone) {
+    check_cursor = into;
+  }
+}
+
+//
+// coalesce - boundary tag coalescing. Return ptr to coalesced block
+//
+static void *coalesce(void *bp) {
+  size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
+  size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+  size_t size = GET_SIZE(HDRP(bp));
+
+  if (prev_alloc && next_alloc) {
+    /* Case 1: both allocated */
+    insert_free(bp);
+    return bp;
+  } else if (prev_alloc && !next_alloc) {
+    /* Case 2: next is free */
+    delete_free(NEXT_BLKP(bp));
+    block_merged(NEXT_BLKP(bp), bp);
+    size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
+    PUT(HDRP(bp), PACK(size, 0));
+    PUT(FTRP(bp), PACK(size, 0));
+    insert_free(bp);
+  } else if (!prev_alloc && next_alloc) {
+    /* Case 3: prev is free */
+    void *prev_bp = PREV_BLKP(bp);
+    delete_free(prev_bp);
+    block_merged(bp, prev_bp);
+    size += GET_SIZE(HDRP(prev_bp));
+    PUT(FTRP(bp), PACK(size, 0));
+    PUT(HDRP(prev_bp), PACK(size, 0));
+    bp = prev_bp;
+    insert_free(bp);
+  } else {
+    /* Case 4: both prev and next are free */
+    void *prev_bp = PREV_BLKP(bp);
+    void *next_bp = NEXT_BLKP(bp);
+    delete_free(prev_bp);
+    delete_free(next_bp);
+    block_merged(bp, prev_bp);
+    block_merged(next_bp, prev_bp);
+    size += GET_SIZE(HDRP(prev_bp)) + GET_SIZE(HDRP(next_bp));
+    PUT(HDRP(prev_bp), PACK(size, 0));
+    PUT(FTRP(next_bp), PACK(size, 0));
+    bp = prev_bp;
+    insert_free(bp);
+  }
+  return bp;
+}
+
+//
+// adjust_size - Block size for a payload of size bytes, including overhead
+// and alignment
+//
+static size_t adjust_size(uint32_t size) {
+  if (size <= (DSIZE - WSIZE)) {
+    return MINBLOCKSIZE; // allocate room for free pointers
+  }
+  return ALIGN(size + OVERHEAD); // add in overhead and room for payload
+}
+
+//
+// mm_malloc - Allocate a block with at least size bytes of payload
+//
+void *mm_malloc(uint32_t size) { return mm_malloc_flags(size, 0); }
+
+//
+// mm_malloc_flags - mm_malloc with MM_* placement flags
+//
+void *mm_malloc_flags(uint32_t size, int flags) {
+  size_t asize; // adjusted block size
+  char *bp = NULL;
+
+  if (size == 0) { // ignore invalid request
+    return NULL;
+  }
+
+  if (flags & MM_CACHE_ALIGN) {
+    return malloc_aligned(size, flags);
+  }
+  asize = adjust_size(size);
+
+  // short-lived blocks are carved from the high end of the heap so they
+  // cluster above long-lived ones and the top can empty out and be trimmed
+  if (flags & MM_SHORT_LIVED) {
+    if ((bp = find_fit_high(asize)) == NULL) {
+      if (flags & MM_FAILFAST) {
+        return NULL;
+      }
+      if ((bp = extend_for(asize)) == NULL) {
+        return pressure_retry(size, flags);
+      }
+    }
+    return place_high(bp, asize);
+  }
+
+  // search free list for a fit, preferring dense regions if asked to
+  if (flags & MM_AVOID_SPARSE) {
+    bp = find_dense_fit(asize);
+  } else if (hot_total != 0 && (bp = hot_pop(asize)) != NULL) {
+    return bp;
+  } else if (reserve_total != 0 && (bp = reserve_pop(asize)) != NULL) {
+    return bp;
+  }
+  if (bp != NULL || (bp = find_fit(asize)) != NULL) {
+    place(bp, asize);
+    return bp;
+  }
+
+  // the blocks held hot may coalesce into a fit
+  if (hot_total != 0) {
+    hot_flush();
+    if ((bp = find_fit(asize)) != NULL) {
+      place(bp, asize);
+      return bp;
+    }
+  }
+
+  // if no fit, request more memory
+  if (flags & MM_FAILFAST) {
+    return NULL;
+  }
+  if ((bp = extend_for(asize)) == NULL) {
+    return pressure_retry(size, flags);
+  }
+  place(bp, asize);
+  return bp;
+}
+
+//
+// malloc_aligned - mm_malloc_flags for MM_CACHE_ALIGN: the payload gets
+// whole cache lines that no other block's payload or tags touch. Other
+// placement flags but MM_FAILFAST are ignored.
+//
+static void *malloc_aligned(uint32_t size, int flags) {
+  size_t lines = ((size_t)size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+  size_t asize = lines + CACHE_LINE; // header in the pad, footer past it
+  size_t need = asize + 2 * CACHE_LINE; // room for the largest pad
+  void *bp;
+
+  if ((bp = find_fit(need)) == NULL && hot_total != 0) {
+    hot_flush();
+    bp = find_fit(need);
+  }
+  if (bp == NULL) {
+    if (flags & MM_FAILFAST) {
+      return NULL;
+    }
+    if ((bp = extend_for(need)) == NULL) {
+      return pressure_retry(size, flags);
+    }
+  }
+  return place_aligned(bp, asize);
+}
+
+//
+// place_aligned - Carve a pad and an asize-byte MM_CACHE_ALIGN block from
+// the low end of free block bp, which must hold asize + 2 * CACHE_LINE
+//
+static void *place_aligned(void *bp, size_t asize) {
+  size_t csize = GET_SIZE(HDRP(bp));
+  char *abp = (char *)(((uintptr_t)bp + 2 * CACHE_LINE - 1) &
+                       ~(uintptr_t)(CACHE_LINE - 1));
+  size_t pad = (size_t)(abp - (char *)bp);
+  size_t rest = csize - pad - asize;
+
+  delete_free(bp);
+  if (rest < MINBLOCKSIZE) {
+    asize += rest;
+    rest = 0;
+  }
+  PUT(HDRP(bp), PACK(pad, 1));
+  PUT(FTRP(bp), PACK(pad, 1));
+  PUT(HDRP(abp), PACK(asize, 1) | ALIGNED_BIT);
+  PUT(FTRP(abp), PACK(asize, 1) | ALIGNED_BIT);
+  account(bp, pad);
+  account(abp, asize);
+
+  if (rest != 0) {
+    void *newp = NEXT_BLKP(abp);
+    PUT(HDRP(newp), PACK(rest, 0));
+    PUT(FTRP(newp), PACK(rest, 0));
+    insert_free(newp);
+  }
+  return abp;
+}
+
+//
+// pressure_retry - The heap could not grow: let the pressure callback shed
+// memory, then try the allocation once more
+//
+static void *pressure_retry(uint32_t size, int flags) {
+  void *bp;
+
+  if (pressure_cb == NULL || in_pressure) {
+    return NULL;
+  }
+  in_pressure = 1;
+  pressure_cb(MM_PRESSURE_EXTEND_FAILED, size, pressure_ctx);
+  bp = mm_malloc_flags(size, flags);
+  in_pressure = 0;
+  return bp;
+}
+
+//
+// mm_comalloc - Allocate n blocks of sizes[i] bytes back to back with one
+// fit search and one split, storing them in out[]. Each block is freed or
+// reallocated on its own; putting the one freed first last lets its space
+// merge with what follows instead of leaving a hole. Returns 0, or -1 if a
+// size is 0 or there is no room (out[] is then untouched).
+//
+int mm_comalloc(size_t n, const uint32_t sizes[], void *out[]) {
+  size_t total = 0;
+  char *bp;
+
+  for (size_t i = 0; i < n; i++) {
+    if (sizes[i] == 0) {
+      return -1;
+    }
+    total += adjust_size(sizes[i]);
+  }
+  if (n == 0) {
+    return 0;
+  }
+
+  if ((bp = find_fit(total)) == NULL && hot_total != 0) {
+    hot_flush();
+    bp = find_fit(total);
+  }
+  if (bp != NULL || (bp = extend_for(total)) != NULL) {
+    place(bp, total);
+  } else if (total - OVERHEAD > UINT32_MAX ||
+             (bp = pressure_retry((uint32_t)(total - OVERHEAD), 0)) == NULL) {
+    return -1;
+  } // else the retry handed back one allocated block of total bytes
+
+  // cut the block into the n blocks; the last keeps any unsplit slack.
+  // Each is counted in its own region, as mm_free will uncount it.
+  total = GET_SIZE(HDRP(bp));
+  for (size_t i = 0; i < n; i++) {
+    size_t asize = i < n - 1 ? adjust_size(sizes[i]) : total;
+    PUT(HDRP(bp), PACK(asize, 1));
+    PUT(FTRP(bp), PACK(asize, 1));
+    if (i > 0) {
+      account(out[0], -(ptrdiff_t)asize);
+      account(bp, asize);
+    }
+    out[i] = bp;
+    bp += asize;
+    total -= asize;
+  }
+  return 0;
+}
+
+//
+// mm_reserve - Get ready for a burst: grow the heap by count blocks for
+// size-byte requests and split them up front onto the class's reserve
+// stack, so the next count such allocations pop one without a search, a
+// split or extend_heap. Reserved blocks go back to the free lists on
+// mm_release_free_memory and when the size classes change. Returns 0 on
+// success.
+//
+int mm_reserve(uint32_t size, uint32_t count) {
+  size_t asize, csize;
+  char *bp, *top;
+  void **link;
+  int index;
+
+  if (size == 0 || count == 0) {
+    return 0;
+  }
+  asize = adjust_size(size);
+  index = get_list_index(asize);
+  if ((bp = extend_heap(asize * count / WSIZE)) == NULL) {
+    return -1;
+  }
+
+  // bp is the heap's top free block; the blocks are linked lowest first
+  // in front of whatever the stack held
+  csize = GET_SIZE(HDRP(bp));
+  delete_free(bp);
+  top = reserve_heads[index];
+  link = &reserve_heads[index];
+  for (uint32_t i = 0; i < count && csize >= asize; i++) {
+    size_t bsize = asize;
+    if (i == count - 1 || csize - asize < asize) {
+      // last block keeps a tail too small to stand alone
+      bsize = (csize - asize >= MINBLOCKSIZE) ? asize : csize;
+    }
+    PUT(HDRP(bp), PACK(bsize, 1) | RESERVED_BIT);
+    PUT(FTRP(bp), PACK(bsize, 1) | RESERVED_BIT);
+    *link = bp;
+    link = (void **)bp;
+    reserve_total++;
+    bp = NEXT_BLKP(bp);
+    csize -= bsize;
+  }
+  *link = top;
+  if (csize > 0) {
+    PUT(HDRP(bp), PACK(csize, 0));
+    PUT(FTRP(bp), PACK(csize, 0));
+    append_free(bp);
+  }
+  return 0;
+}
+
+//
+// mm_malloc_tagged - Allocate a block owned by tag. Tag 0 means untagged
+// and is not accounted.
+//
+void *mm_malloc_tagged(uint32_t size, int tag) {
+  void *bp = mm_malloc(size);
+
+  tag &= MM_NUM_TAGS - 1;
+  if (bp != NULL && tag) {
+    uint64_t word = GET(HDRP(bp)) | ((uint64_t)tag << TAG_SHIFT);
+    PUT(HDRP(bp), word);
+    PUT(FTRP(bp), word);
+    tag_bytes[tag] += GET_SIZE(HDRP(bp)) - OVERHEAD;
+    tag_count[tag]++;
+  }
+  return bp;
+}
+
+//
+// mm_tag_stats - Live payload bytes and object count for a tag
+//
+void mm_tag_stats(int tag, struct mm_tag_usage *usage) {
+  tag &= MM_NUM_TAGS - 1;
+  usage->bytes = tag_bytes[tag];
+  usage->count = tag_count[tag];
+}
+
+//
+// mm_malloc_hint - Allocate with a lifetime hint. MM_SHORT_LIVED blocks are
+// placed top-down, MM_LONG_LIVED (the default) bottom-up.
+//
+void *mm_malloc_hint(uint32_t size, int hint) {
+  return mm_malloc_flags(size, hint & (MM_SHORT_LIVED | MM_LONG_LIVED));
+}
+
+//
+// mm_should_move - Defrag hint: true if the live block at ptr sits in a
+// region that is less utilized than the heap overall, so reallocating it
+// with MM_AVOID_SPARSE and freeing the original would help empty the region
+//
+int mm_should_move(void *ptr) {
+  if (ptr == NULL || !GET_ALLOC(HDRP(ptr))) {
+    return 0;
+  }
+  return region_is_sparse(ptr);
+}
+
+//
+// place - Place block of asize bytes at start of free block bp
+//         and split if remainder >= MINBLOCKSIZE, insert remainder if split
+//
+static void place(void *bp, size_t asize) {
+  size_t csize = GET_SIZE(HDRP(bp));
+
+  delete_free(bp); // remove block from free list
+
+  if ((csize - asize) >= MINBLOCKSIZE) {
+    // set header/footer
+    PUT(HDRP(bp), PACK(asize, 1));
     PUT(FTRP(bp), PACK(asize, 1));
+    account(bp, asize);
+
+    // remainder becomes a free block
+    void *newp = NEXT_BLKP(bp);
+    PUT(HDRP(newp), PACK(csize - asize, 0));
+    PUT(FTRP(newp), PACK(csize - asize, 0));
+    insert_free(newp);
+    if (config.fit == FIT_NEXT) {
+      // the next search resumes where this allocation ended
+      segregated_rovers[get_list_index(csize - asize)] = newp;
+    }
+  } else { // no splits
+    PUT(HDRP(bp), PACK(csize, 1));
+    PUT(FTRP(bp), PACK(csize, 1));
+    account(bp, csize);
+  }
+}
+
+//
+// place_high - Place block of asize bytes at the end of free block bp,
+//              leaving the front as the free remainder. Returns the block.
+//
+static void *place_high(void *bp, size_t asize) {
+  size_t csize = GET_SIZE(HDRP(bp));
+
+  delete_free(bp);
+
+  if ((csize - asize) >= MINBLOCKSIZE) {
+    PUT(HDRP(bp), PACK(csize - asize, 0));
+    PUT(FTRP(bp), PACK(csize - asize, 0));
+    insert_free(bp);
+    bp = NEXT_BLKP(bp);
+    csize = asize;
+  }
+  PUT(HDRP(bp), PACK(csize, 1));
+  PUT(FTRP(bp), PACK(csize, 1));
+  account(bp, csize);
+  return bp;
+}
+
+//
+// mm_free - Free a block
+//
+void mm_free(void *bp) {
+  size_t size = GET_SIZE(HDRP(bp)); // get block size from header
+  int tag = GET_TAG(HDRP(bp));
+  // neighbour tags for coalesce: the previous footer and the next header
+  PREFETCH((char *)bp - DSIZE);
+  PREFETCH((char *)bp + size - WSIZE);
+  account(bp, -(ptrdiff_t)size);
+  if (tag) {
+    tag_bytes[tag] -= size - OVERHEAD;
+    tag_count[tag]--;
+  }
+
+  if (GET_ALIGNED(HDRP(bp))) {
+    // free the pad below along with the block, as one block
+    char *pad = PREV_BLKP(bp);
+    account(pad, -(ptrdiff_t)GET_SIZE(HDRP(pad)));
+    size += GET_SIZE(HDRP(pad));
+    PUT(HDRP(pad), PACK(size, 1));
+    PUT(FTRP(pad), PACK(size, 1));
+    block_merged(bp, pad);
+    free_block(pad);
+  } else if (config.hot && size <= HOT_MAX_SIZE && !soft_pressure) {
+    hot_push(bp);
+  } else {
+    free_block(bp);
+  }
+}
+
+//
+// free_block - Return an unaccounted block to the free lists
+//
+static void free_block(void *bp) {
+  size_t size = GET_SIZE(HDRP(bp));
+
+  PUT(HDRP(bp), PACK(size, 0)); // set header pointer of freed block to 0
+  PUT(FTRP(bp), PACK(size, 0)); // set header pointer of freed block to 0
+
+  coalesce(bp); // merge adjacent free blocks
+  if (soft_pressure || config.trim_threshold) {
+    trim_on_free();
+  }
+}
+
+//
+// hot_pop - Reuse the most recently freed hot block that fits asize the way
+// place would (a remainder too small to split), or return NULL
+//
+static void *hot_pop(size_t asize) {
+  int i = get_list_index(asize);
+
+  for (int k = hot_count[i] - 1; k >= 0; k--) {
+    void *bp = hot_blocks[i][k];
+    size_t size = GET_SIZE(HDRP(bp));
+    if (size >= asize && size - asize < MINBLOCKSIZE) {
+      memmove(&hot_blocks[i][k], &hot_blocks[i][k + 1],
+              (size_t)(hot_count[i] - k - 1) * sizeof(void *));
+      hot_count[i]--;
+      hot_total--;
+      account(bp, size);
+      return bp;
+    }
+  }
+  return NULL;
+}
+
+//
+// is_hot - Whether bp, a size-byte block marked allocated, is held in the
+// hot buffer and so really free
+//
+static int is_hot(void *bp, size_t size) {
+  int i = get_list_index(size);
+
+  for (int k = 0; k < hot_count[i]; k++) {
+    if (hot_blocks[i][k] == bp) {
+      return 1;
+    }
+  }
+  return 0;
+}
 
-    // remainder becomes a free block
-    void *newp = NEXT_BLKP(bp);
-    PUT(HDRP(newp), PACK(csize - asize, 0));
-    PUT(FTRP(newp), PACK(csize - asize, 0));
-    SET_NEXT_FREE(newp, NULL);
-    SET_PREV_FREE(newp, NULL);
-    insert_free(newp);
-  } else { // no splits
-    PUT(HDRP(bp), PACK(csize, 1));
-    PUT(FTRP(bp), PACK(csize, 1));
+//
+// hot_push - Hold a freed block in its class's hot buffer, freeing the
+// oldest one for real if the buffer is full
+//
+static void hot_push(void *bp) {
+  size_t size = GET_SIZE(HDRP(bp));
+  int i = get_list_index(size);
+
+  PUT(HDRP(bp), PACK(size, 1)); // drop the tag and handle bits
+  PUT(FTRP(bp), PACK(size, 1));
+  if (hot_count[i] >= config.hot) {
+    void *oldest = hot_blocks[i][0];
+    memmove(&hot_blocks[i][0], &hot_blocks[i][1],
+            (size_t)(hot_count[i] - 1) * sizeof(void *));
+    hot_count[i]--;
+    hot_total--;
+    free_block(oldest);
   }
+  hot_blocks[i][hot_count[i]++] = bp;
+  hot_total++;
 }
 
 //
-// mm_free - Free a block
+// hot_flush - Free every block held in the hot buffers
 //
-void mm_free(void *bp) {
-  size_t size = GET_SIZE(HDRP(bp)); // get block size from header
+static void hot_flush(void) {
+  for (int i = 0; i < NUM_FREE_LISTS; i++) {
+    for (int k = 0; k < hot_count[i]; k++) {
+      free_block(hot_blocks[i][k]);
+    }
+    hot_count[i] = 0;
+  }
+  hot_total = 0;
+}
 
-  PUT(HDRP(bp), PACK(size, 0)); // set header pointer of freed block to 0
-  PUT(FTRP(bp), PACK(size, 0)); // set header pointer of freed block to 0
+//
+// reserve_pop - Hand out a reserved block of asize's class that fits asize
+// the way place would, or return NULL. A class can hold reservations of
+// several sizes; each mm_reserve pushes its run in front, so the scan
+// usually stops at the top.
+//
+static void *reserve_pop(size_t asize) {
+  void **link = &reserve_heads[get_list_index(asize)];
+  void *bp;
+  size_t size;
 
-  // Null reference pointers
-  SET_NEXT_FREE(bp, NULL);
-  SET_PREV_FREE(bp, NULL);
+  for (bp = *link; bp != NULL; link = (void **)bp, bp = *link) {
+    size = GET_SIZE(HDRP(bp));
+    if (size >= asize && size - asize < MINBLOCKSIZE) {
+      break;
+    }
+  }
+  if (bp == NULL) {
+    return NULL;
+  }
+  *link = *(void **)bp;
+  reserve_total--;
+  PUT(HDRP(bp), PACK(size, 1));
+  PUT(FTRP(bp), PACK(size, 1));
+  account(bp, size);
+  return bp;
+}
 
-  coalesce(bp); // merge adjacent free blocks
+//
+// reserve_flush - Free every block still on a reserve stack
+//
+static void reserve_flush(void) {
+  for (int i = 0; i < NUM_FREE_LISTS; i++) {
+    while (reserve_heads[i] != NULL) {
+      void *bp = reserve_heads[i];
+      reserve_heads[i] = *(void **)bp;
+      free_block(bp);
+    }
+  }
+  reserve_total = 0;
 }
 
 //
@@ -400,26 +2018,51 @@ void *mm_realloc(void *ptr, uint32_t size) {
     return NULL;
   }
 
+  // MM_CACHE_ALIGN blocks stay in place while the payload fits, else move
+  if (GET_ALIGNED(HDRP(ptr))) {
+    size_t room = GET_SIZE(HDRP(ptr)) - CACHE_LINE;
+    if (size <= room) {
+      realloc_kept++;
+      return ptr;
+    }
+    void *new_ptr = mm_malloc_flags(size, MM_CACHE_ALIGN);
+    if (new_ptr != NULL) {
+      memcpy(new_ptr, ptr, room);
+      mm_free(ptr);
+    }
+    return new_ptr;
+  }
+
   // 1. Calculate new size
   size_t new_size = ALIGN(size + OVERHEAD);
   if (new_size < MINBLOCKSIZE) {
     new_size = MINBLOCKSIZE;
   }
   size_t old_size = GET_SIZE(HDRP(ptr));
+  uint64_t extra = GET_EXTRA(HDRP(ptr));
+  int tag = GET_TAG(HDRP(ptr));
 
-  // 2. Shrinking case
+  // 2. Shrinking case: a cut too small to free, or under config.shrink
+  // percent of the block, leaves it untouched so the next grow has room
   if (new_size <= old_size) {
-    if (old_size - new_size >= MINBLOCKSIZE) {
-      // Split the block
-      PUT(HDRP(ptr), PACK(new_size, 1));
-      PUT(FTRP(ptr), PACK(new_size, 1));
+    size_t cut = old_size - new_size;
+    if (cut < MINBLOCKSIZE || cut * 100 < old_size * (size_t)config.shrink) {
+      realloc_kept++;
+      return ptr;
+    }
 
-      void *new_free_bp = NEXT_BLKP(ptr);
-      PUT(HDRP(new_free_bp), PACK(old_size - new_size, 0));
-      PUT(FTRP(new_free_bp), PACK(old_size - new_size, 0));
-      coalesce(new_free_bp); // Coalesce the new free block
+    // Split the block
+    PUT(HDRP(ptr), PACK(new_size, 1) | extra);
+    PUT(FTRP(ptr), PACK(new_size, 1) | extra);
+
+    void *new_free_bp = NEXT_BLKP(ptr);
+    PUT(HDRP(new_free_bp), PACK(cut, 0));
+    PUT(FTRP(new_free_bp), PACK(cut, 0));
+    account(ptr, -(ptrdiff_t)cut);
+    if (tag) {
+      tag_bytes[tag] -= cut;
     }
-    // else: no splitting, just return original ptr
+    coalesce(new_free_bp); // Coalesce the new free block
     return ptr;
   }
 
@@ -429,34 +2072,668 @@ void *mm_realloc(void *ptr, uint32_t size) {
       (old_size + GET_SIZE(HDRP(next_bp))) >= new_size) {
     // Coalesce with the next free block
     delete_free(next_bp);
+    block_merged(next_bp, ptr);
     size_t combined_size = old_size + GET_SIZE(HDRP(next_bp));
 
-    PUT(HDRP(ptr), PACK(combined_size, 1));
-    PUT(FTRP(ptr), PACK(combined_size, 1));
+    PUT(HDRP(ptr), PACK(combined_size, 1) | extra);
+    PUT(FTRP(ptr), PACK(combined_size, 1) | extra);
 
     // Optionally, split the coalesced block
     if (combined_size - new_size >= MINBLOCKSIZE) {
-      PUT(HDRP(ptr), PACK(new_size, 1));
-      PUT(FTRP(ptr), PACK(new_size, 1));
+      PUT(HDRP(ptr), PACK(new_size, 1) | extra);
+      PUT(FTRP(ptr), PACK(new_size, 1) | extra);
 
       void *new_free_bp = NEXT_BLKP(ptr);
       PUT(HDRP(new_free_bp), PACK(combined_size - new_size, 0));
       PUT(FTRP(new_free_bp), PACK(combined_size - new_size, 0));
       insert_free(new_free_bp); // Insert the remainder
     }
+    account(ptr, GET_SIZE(HDRP(ptr)) - old_size);
+    if (tag) {
+      tag_bytes[tag] += GET_SIZE(HDRP(ptr)) - old_size;
+    }
     return ptr;
   }
 
-  // 4. Fallback to naive realloc
-  void *new_ptr = mm_malloc(size);
+  // 4. Fallback to naive realloc, keeping the block's tag
+  void *new_ptr = mm_malloc_tagged(size, tag);
   if (new_ptr == NULL) {
     return NULL; // Malloc failed
   }
-  memcpy(new_ptr, ptr, size);
+  memcpy(new_ptr, ptr, old_size - OVERHEAD); // growing: copy old payload
   mm_free(ptr);
   return new_ptr;
 }
 
+//
+// mm_get_stats - Snapshot heap counters
+//
+void mm_get_stats(struct mm_stats *st) {
+  st->heap_size = heap_size;
+  st->alloc_bytes = alloc_bytes;
+  st->realloc_kept = realloc_kept;
+}
+
+//
+// mm_set_limit - Cap the heap at hard bytes; past soft bytes free memory is
+// purged and trimmed eagerly. 0 disables a limit.
+//
+void mm_set_limit(size_t hard, size_t soft) {
+  hard_limit = hard;
+  soft_limit = soft;
+  update_limit_check();
+  soft_pressure = soft != 0 && heap_size > soft;
+}
+
+//
+// update_limit_check - Recompute the single bound extend_heap tests
+//
+static void update_limit_check(void) {
+  limit_check = SIZE_MAX;
+  if (hard_limit != 0 && hard_limit < limit_check) {
+    limit_check = hard_limit;
+  }
+  if (soft_limit != 0 && soft_limit < limit_check) {
+    limit_check = soft_limit;
+  }
+  if (watermark_armed && watermark < limit_check) {
+    limit_check = watermark;
+  }
+}
+
+//
+// mm_set_limit_handler - Called with the requested extension when the hard
+// limit refuses it; the allocation then fails
+//
+void mm_set_limit_handler(mm_limit_handler handler) {
+  limit_handler = handler;
+}
+
+//
+// mm_set_pressure_callback - Register cb, invoked with MM_PRESSURE_* events
+// when the heap cannot grow or grows past the watermark. After an
+// MM_PRESSURE_EXTEND_FAILED event the allocation is retried once.
+//
+void mm_set_pressure_callback(mm_pressure_callback cb, void *ctx) {
+  pressure_cb = cb;
+  pressure_ctx = ctx;
+}
+
+//
+// mm_set_watermark - Raise MM_PRESSURE_WATERMARK when the heap grows past
+// bytes; re-armed once trimming brings it back below. 0 disables it.
+//
+void mm_set_watermark(size_t bytes) {
+  watermark = bytes;
+  watermark_armed = bytes != 0 && heap_size <= bytes;
+  update_limit_check();
+}
+
+//
+// mm_release_free_memory - Give free memory back to the system.
+// MM_RELEASE_TRIM returns the free block at the heap top, MM_RELEASE_PURGE
+// also drops the whole pages inside every other free block. Returns the
+// number of bytes released.
+//
+size_t mm_release_free_memory(int level) {
+  size_t released;
+
+  hot_flush();
+  reserve_flush();
+  released = trim_top();
+
+  if (level >= MM_RELEASE_PURGE) {
+    released += purge_free_pages();
+  }
+  if (soft_pressure && heap_size <= soft_limit) {
+    soft_pressure = 0;
+  }
+  return released;
+}
+
+//
+// parse_size - Parse a byte count with an optional k, m or g suffix
+//
+static int parse_size(const char *value, size_t *out) {
+  static const char units[] = "kmg";
+  const char *unit;
+  char *end;
+  unsigned long long n = strtoull(value, &end, 10);
+
+  if (end == value) {
+    return -1;
+  }
+  if (*end != '\0' && (unit = strchr(units, tolower(*end))) != NULL) {
+    n <<= 10 * (unit - units + 1);
+    end++;
+  }
+  if (*end != '\0') {
+    return -1;
+  }
+  *out = (size_t)n;
+  return 0;
+}
+
+//
+// mm_config_set - Set one tunable by name. Returns 0, or -1 if the key is
+// unknown or the value is invalid.
+//
+//   chunk      heap extension step                         (4k)
+//   trim       trim a free heap top of this size on free   (0, off)
+//   region     defrag region size, power of two            (64k)
+//   fit        placement policy, "first", "best" or "next" (first)
+//   hot        recently freed blocks kept per class, 0-16  (0, off)
+//   shrink     realloc shrinks by less than this % in place (0, off)
+//   wilderness 1: use the free heap top only if nothing else fits (0, off)
+//   classes    size class bounds, "32/64/128/..." ascending
+//   hard, soft heap limits, as mm_set_limit                (0, off)
+//   watermark  pressure watermark, as mm_set_watermark     (0, off)
+//
+int mm_config_set(const char *key, const char *value) {
+  size_t n;
+
+  if (strcmp(key, "fit") == 0) {
+    if (strcmp(value, "first") == 0) {
+      config.fit = FIT_FIRST;
+    } else if (strcmp(value, "best") == 0) {
+      config.fit = FIT_BEST;
+    } else if (strcmp(value, "next") == 0) {
+      config.fit = FIT_NEXT;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+
+  if (strcmp(key, "classes") == 0) {
+    size_t limits[NUM_FREE_LISTS - 1];
+    int count = 0;
+    const char *p = value;
+    while (*p != '\0' && count < NUM_FREE_LISTS - 1) {
+      char *end;
+      limits[count] = (size_t)strtoull(p, &end, 10);
+      if (end == p || (count > 0 && limits[count] <= limits[count - 1])) {
+        return -1;
+      }
+      count++;
+      p = (*end == '/') ? end + 1 : end;
+    }
+    if (count == 0 || *p != '\0') {
+      return -1;
+    }
+    if (heap_listp != NULL) {
+      hot_flush(); // the buffers are indexed by the old classes
+      reserve_flush();
+    }
+    for (int i = 0; i < NUM_FREE_LISTS - 1; i++) {
+      class_limits[i] = (i < count) ? limits[i] : SIZE_MAX;
+    }
+    build_class_lut();
+    if (heap_listp != NULL) {
+      rebuild_free_lists();
+    }
+    return 0;
+  }
+
+  if (parse_size(value, &n) == -1) {
+    return -1;
+  }
+  if (strcmp(key, "chunk") == 0) {
+    if (n < MINBLOCKSIZE) {
+      return -1;
+    }
+    config.chunk = (n + DSIZE - 1) & ~(size_t)(DSIZE - 1);
+  } else if (strcmp(key, "trim") == 0) {
+    config.trim_threshold = n;
+  } else if (strcmp(key, "region") == 0) {
+    if (n < MINBLOCKSIZE || (n & (n - 1)) != 0) {
+      return -1;
+    }
+    return set_region(n);
+  } else if (strcmp(key, "hard") == 0) {
+    mm_set_limit(n, soft_limit);
+  } else if (strcmp(key, "soft") == 0) {
+    mm_set_limit(hard_limit, n);
+  } else if (strcmp(key, "watermark") == 0) {
+    mm_set_watermark(n);
+  } else if (strcmp(key, "hot") == 0) {
+    if (n > HOT_SLOTS) {
+      return -1;
+    }
+    if (heap_listp != NULL) {
+      hot_flush();
+    }
+    config.hot = (int)n;
+  } else if (strcmp(key, "shrink") == 0) {
+    if (n > 100) {
+      return -1;
+    }
+    config.shrink = (int)n;
+  } else if (strcmp(key, "wilderness") == 0) {
+    if (n > 1) {
+      return -1;
+    }
+    config.wilderness = (int)n;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+//
+// mm_config_load - Apply a "key:value,key:value" list with mm_config_set.
+// Returns -1 if any entry was rejected; the others still apply.
+//
+int mm_config_load(const char *conf) {
+  char key[32], value[256];
+  int status = 0;
+
+  while (*conf != '\0') {
+    size_t klen = strcspn(conf, ":,");
+    size_t vlen = 0;
+    const char *v = conf + klen;
+
+    if (*v == ':') {
+      v++;
+      vlen = strcspn(v, ",");
+    }
+    if (klen < sizeof(key) && vlen < sizeof(value)) {
+      memcpy(key, conf, klen);
+      key[klen] = '\0';
+      memcpy(value, v, vlen);
+      value[vlen] = '\0';
+      if (mm_config_set(key, value) == -1) {
+        status = -1;
+      }
+    } else {
+      status = -1;
+    }
+    conf = v + vlen;
+    if (*conf == ',') {
+      conf++;
+    }
+  }
+  return status;
+}
+
+//
+// mm_halloc - Allocate a movable block of size bytes and return its handle,
+// or 0 on failure. The payload is only reachable through mm_hpin.
+//
+mm_handle_t mm_halloc(uint32_t size) {
+  uint32_t h;
+  char *bp;
+
+  if (size == 0 || size > UINT32_MAX - WSIZE) {
+    return 0;
+  }
+
+  // grow the table when it is full. It lives outside the heap so that it
+  // never pins the top of the heap against trimming.
+  if (handle_unused == 0) {
+    uint32_t cap = handle_cap ? 2 * handle_cap : 256;
+    struct handle_slot *table =
+        mmap(NULL, cap * sizeof(struct handle_slot), PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (table == MAP_FAILED) {
+      return 0;
+    }
+    if (handle_table != NULL) {
+      memcpy(table, handle_table, handle_cap * sizeof(struct handle_slot));
+      munmap(handle_table, handle_cap * sizeof(struct handle_slot));
+    }
+    for (uint32_t i = handle_cap; i < cap; i++) {
+      table[i].bp = NULL;
+      table[i].pins = 0;
+      table[i].next = (i + 1 < cap) ? i + 2 : 0;
+    }
+    handle_table = table;
+    handle_unused = handle_cap + 1;
+    handle_cap = cap;
+  }
+
+  if ((bp = mm_malloc(size + WSIZE)) == NULL) {
+    return 0;
+  }
+  h = handle_unused;
+  handle_unused = handle_table[h - 1].next;
+
+  PUT(HDRP(bp), GET(HDRP(bp)) | HANDLE_BIT);
+  PUT(FTRP(bp), GET(FTRP(bp)) | HANDLE_BIT);
+  PUT(bp, h);
+  handle_table[h - 1].bp = bp;
+  handle_table[h - 1].pins = 0;
+  return h;
+}
+
+//
+// mm_hfree - Free a handle and its block
+//
+void mm_hfree(mm_handle_t h) {
+  struct handle_slot *slot = &handle_table[h - 1];
+
+  mm_free(slot->bp);
+  slot->bp = NULL;
+  slot->pins = 0;
+  slot->next = handle_unused;
+  handle_unused = h;
+}
+
+//
+// mm_hpin/mm_hunpin - Pin a handle's block in place and return its payload.
+// The pointer stays valid until the matching mm_hunpin.
+//
+void *mm_hpin(mm_handle_t h) {
+  struct handle_slot *slot = &handle_table[h - 1];
+
+  slot->pins++;
+  return (char *)slot->bp + WSIZE;
+}
+
+void mm_hunpin(mm_handle_t h) { handle_table[h - 1].pins--; }
+
+//
+// mm_hcompact - Incremental compaction. Visits at most max_blocks blocks
+// in address order starting where the previous call stopped, sliding each
+// unpinned handle block down into the free block in front of it so free
+// space migrates toward the epilogue. When the sweep reaches the epilogue
+// the top free block is trimmed and the next call starts over.
+// Returns the number of blocks moved.
+//
+size_t mm_hcompact(size_t max_blocks) {
+  char *bp;
+  size_t moved = 0;
+
+  // blocks held hot would stand in the sweep's way like live ones
+  hot_flush();
+  bp = compact_cursor;
+
+  for (; max_blocks > 0; max_blocks--) {
+    if (bp == heap_hi) {
+      trim_top();
+      bp = heap_listp;
+      break;
+    }
+
+    char *next = NEXT_BLKP(bp);
+    if (GET_ALLOC(HDRP(bp)) || !GET_HANDLE(HDRP(next)) ||
+        handle_table[GET(next) - 1].pins > 0) {
+      bp = next;
+      continue;
+    }
+
+    // bp is free and next is an unpinned handle block: swap their places
+    size_t fsize = GET_SIZE(HDRP(bp));
+    size_t bsize = GET_SIZE(HDRP(next));
+    uint64_t btags = GET(HDRP(next));
+
+    delete_free(bp);
+    account(next, -(ptrdiff_t)bsize);
+    account(bp, bsize);
+    memmove(bp, next, bsize - OVERHEAD);
+    PUT(HDRP(bp), btags);
+    PUT(FTRP(bp), btags);
+    handle_table[GET(bp) - 1].bp = bp;
+    if (walk_cursor == next) {
+      walk_cursor = bp; // the block it was about to visit moved down
+    }
+    if (check_cursor == next) {
+      check_cursor = bp;
+    }
+
+    char *freep = NEXT_BLKP(bp);
+    PUT(HDRP(freep), PACK(fsize, 0));
+    PUT(FTRP(freep), PACK(fsize, 0));
+    bp = coalesce(freep);
+    moved++;
+  }
+
+  compact_cursor = bp;
+  return moved;
+}
+
+//
+// walk_visit - Pass block bp to cb unless it is the allocator's own: the
+// prologue or the pad below an MM_CACHE_ALIGN block. Hot and reserved
+// blocks are marked allocated but reported free.
+//
+static int walk_visit(char *bp, mm_walk_callback cb, void *ctx) {
+  size_t size = GET_SIZE(HDRP(bp));
+  int allocated = GET_ALLOC(HDRP(bp)) && !GET_RESERVED(HDRP(bp));
+
+  if (bp == heap_listp || GET_ALIGNED(HDRP(NEXT_BLKP(bp)))) {
+    return 0;
+  }
+  if (allocated && hot_total != 0 && is_hot(bp, size)) {
+    allocated = 0;
+  }
+  return cb(bp, size - OVERHEAD, allocated, ctx);
+}
+
+//
+// mm_heap_walk - Call cb for every block in address order. Returns 0, or
+// the nonzero value cb stopped the walk with.
+//
+int mm_heap_walk(mm_walk_callback cb, void *ctx) {
+  int stop;
+
+  for (char *bp = heap_listp; bp != heap_hi; bp = NEXT_BLKP(bp)) {
+    if ((stop = walk_visit(bp, cb, ctx)) != 0) {
+      return stop;
+    }
+  }
+  return 0;
+}
+
+//
+// mm_heap_walk_step - Incremental mm_heap_walk. Visits at most max_blocks
+// blocks in address order starting where the previous call stopped, or
+// fewer if cb returns nonzero. The heap may change between calls: every
+// block is seen as it is at the time of the visit, and a block that
+// merges with or moves below the resume point is visited again. Returns 1
+// when the walk reaches the epilogue (the next call starts over), 0
+// otherwise.
+//
+int mm_heap_walk_step(mm_walk_callback cb, void *ctx, size_t max_blocks) {
+  char *bp = walk_cursor;
+
+  for (; max_blocks > 0 && bp != heap_hi; max_blocks--) {
+    int stop = walk_visit(bp, cb, ctx);
+    bp = NEXT_BLKP(bp);
+    if (stop) {
+      break;
+    }
+  }
+
+  if (bp == heap_hi) {
+    walk_cursor = heap_listp;
+    return 1;
+  }
+  walk_cursor = bp;
+  return 0;
+}
+
+//
+// mm_validate - Check every block and its free-list links without
+// printing. Returns MM_VALID_OK or the first MM_VALID_* error, and points
+// *bad (if not NULL) at the offending block.
+//
+int mm_validate(void **bad) {
+  int err = MM_VALID_OK;
+  char *bp;
+
+  for (bp = heap_listp; bp != heap_hi; bp = NEXT_BLKP(bp)) {
+    if ((err = validate_block(bp)) != MM_VALID_OK) {
+      break;
+    }
+  }
+  if (err == MM_VALID_OK && GET(HDRP(bp)) != PACK(0, 1)) {
+    err = MM_VALID_EDGE;
+  }
+  if (err != MM_VALID_OK && bad != NULL) {
+    *bad = bp;
+  }
+  return err;
+}
+
+//
+// mm_validate_step - Incremental mm_validate for continuous checking in
+// production. Checks the list heads and at most max_blocks blocks starting
+// where the previous call stopped. Returns MM_VALID_DONE when a pass
+// reaches the epilogue clean (the next call starts over), MM_VALID_OK if
+// blocks remain, or an error as mm_validate does; a failed pass starts
+// over as well.
+//
+int mm_validate_step(size_t max_blocks, void **bad) {
+  char *bp = check_cursor;
+  int err = MM_VALID_OK;
+
+  // list heads, so a list whose every entry is stale is caught too
+  for (int i = 0; i < NUM_FREE_LISTS && err == MM_VALID_OK; i++) {
+    free_ref f = FIRST_FREE(i);
+    if (f != NO_FREE && GET_ALLOC(HDRP(FREE_BP(f)))) {
+      bp = FREE_BP(f);
+      err = MM_VALID_LINK;
+    }
+  }
+
+  for (; err == MM_VALID_OK && max_blocks > 0 && bp != heap_hi;
+       max_blocks--) {
+    if ((err = validate_block(bp)) == MM_VALID_OK) {
+      bp = NEXT_BLKP(bp);
+    }
+  }
+  if (err == MM_VALID_OK && bp != heap_hi) {
+    check_cursor = bp;
+    return MM_VALID_OK;
+  }
+  if (err == MM_VALID_OK && GET(HDRP(bp)) != PACK(0, 1)) {
+    err = MM_VALID_EDGE;
+  }
+  check_cursor = heap_listp;
+  if (err != MM_VALID_OK && bad != NULL) {
+    *bad = bp;
+  }
+  return err == MM_VALID_OK ? MM_VALID_DONE : err;
+}
+
+//
+// validate_block - Check one block's tags and, if it is free, that it has
+// no free neighbour above and is linked into the right free list
+//
+static int validate_block(char *bp) {
+  uint64_t hdr = GET(HDRP(bp));
+  size_t size = GET_SIZE(HDRP(bp));
+
+  if (bp == heap_listp) {
+    return size == DSIZE && GET_ALLOC(HDRP(bp)) && GET(FTRP(bp)) == hdr
+               ? MM_VALID_OK
+               : MM_VALID_EDGE;
+  }
+  if (size < MINBLOCKSIZE || size % ALIGNMENT != 0 ||
+      size > (size_t)(heap_hi - bp)) {
+    return MM_VALID_SIZE;
+  }
+  if (GET(FTRP(bp)) != hdr) {
+    return MM_VALID_TAGS;
+  }
+  if (GET_ALLOC(HDRP(bp))) {
+    return MM_VALID_OK;
+  }
+
+  char *next = NEXT_BLKP(bp);
+  if (next != heap_hi && !GET_ALLOC(HDRP(next))) {
+    return MM_VALID_ADJACENT;
+  }
+  return validate_free(bp, size);
+}
+
+#ifdef MM_SIDE_TABLE
+// leaf_valid - True if leaf is an in-use leaf of the side table
+static int leaf_valid(struct free_leaf *leaf) {
+  for (struct leaf_chunk *c = leaf_chunks; c != NULL; c = c->next) {
+    size_t used = c == leaf_chunk ? leaf_used : c->leaves;
+    size_t off = (size_t)((char *)leaf - (char *)c);
+
+    if ((char *)leaf >= (char *)c && off < used * LEAF_BYTES) {
+      return off >= LEAF_BYTES && off % LEAF_BYTES == 0 &&
+             leaf->count >= 1 && leaf->count <= LEAF_N;
+    }
+    if (c == leaf_chunk) {
+      break; // later chunks have no leaves cut yet
+    }
+  }
+  return 0;
+}
+#endif
+
+//
+// validate_free - Check free block bp's place on its list: it is linked
+// both ways with its list neighbours, which are free, of the same size
+// class and on either side of it in address order, and it is the list's
+// head or tail where it has no neighbour
+//
+static int validate_free(char *bp, size_t size) {
+  int index = get_list_index(size);
+  free_ref f, prev, next;
+
+#ifdef MM_SIDE_TABLE
+  struct free_leaf *leaf = *(struct free_leaf **)bp;
+  size_t k;
+
+  if (!leaf_valid(leaf) ||
+      (leaf->prev != NULL &&
+       (!leaf_valid(leaf->prev) || leaf->prev->next != leaf)) ||
+      (leaf->next != NULL &&
+       (!leaf_valid(leaf->next) || leaf->next->prev != leaf))) {
+    return MM_VALID_LINK;
+  }
+  for (k = 0; k < leaf->count && leaf->blocks[k] != bp; k++)
+    ;
+  if (k == leaf->count || leaf->sizes[k] != size) {
+    return MM_VALID_LINK;
+  }
+  f = &leaf->sizes[k];
+  prev = PREV_FREE(f);
+  next = NEXT_FREE(f);
+#else
+  f = bp;
+  prev = PREV_FREE(f);
+  next = NEXT_FREE(f);
+  // in-block links must stay inside the heap and point back at bp
+  if ((prev != NO_FREE &&
+       (prev <= heap_listp || prev >= heap_hi || NEXT_FREE(prev) != f)) ||
+      (next != NO_FREE &&
+       (next <= heap_listp || next >= heap_hi || PREV_FREE(next) != f))) {
+    return MM_VALID_LINK;
+  }
+#endif
+
+  if ((prev != NO_FREE && GET_ALLOC(HDRP(FREE_BP(prev)))) ||
+      (next != NO_FREE && GET_ALLOC(HDRP(FREE_BP(next))))) {
+    return MM_VALID_LINK;
+  }
+  if ((prev != NO_FREE && FREE_BP(prev) >= bp) ||
+      (next != NO_FREE && FREE_BP(next) <= bp)) {
+    return MM_VALID_ORDER;
+  }
+  if ((prev != NO_FREE && get_list_index(FREE_SIZE(prev)) != index) ||
+      (next != NO_FREE && get_list_index(FREE_SIZE(next)) != index)) {
+    return MM_VALID_CLASS;
+  }
+  if ((prev == NO_FREE && FIRST_FREE(index) != f) ||
+      (next == NO_FREE && LAST_FREE(index) != f)) {
+    // an end of some other class's list?
+    for (int i = 0; i < NUM_FREE_LISTS; i++) {
+      if (FIRST_FREE(i) == f || LAST_FREE(i) == f) {
+        return MM_VALID_CLASS;
+      }
+    }
+    return MM_VALID_LINK;
+  }
+  return MM_VALID_OK;
+}
+
 //
 // mm_checkheap - Check the heap for consistency
 //
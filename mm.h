@@ -1,6 +1,86 @@
+#include <stddef.h>
 #include <stdint.h>
 
+/* mm_malloc_flags placement flags */
+#define MM_AVOID_SPARSE 0x1 /* skip free blocks in sparsely used regions */
+#define MM_SHORT_LIVED 0x2  /* lifetime hint: place at the top of the heap */
+#define MM_LONG_LIVED 0x4   /* lifetime hint: place at the bottom (default) */
+#define MM_FAILFAST 0x8     /* return NULL rather than grow the heap */
+#define MM_CACHE_ALIGN 0x10 /* payload on cache lines of its own */
+
+struct mm_stats {
+  size_t heap_size;    /* bytes obtained from the system */
+  size_t alloc_bytes;  /* bytes in allocated blocks, including tags */
+  size_t realloc_kept; /* mm_realloc calls that left the block as is */
+};
+
+/* mm_malloc_tagged tags are 1..MM_NUM_TAGS-1, 0 means untagged */
+#define MM_NUM_TAGS 256
+
+struct mm_tag_usage {
+  size_t bytes; /* live payload bytes */
+  size_t count; /* live objects */
+};
+
+/* called when the heap limit refuses an extension of request bytes */
+typedef void (*mm_limit_handler)(size_t request);
+
+/* mm_pressure_callback events */
+#define MM_PRESSURE_EXTEND_FAILED 1 /* heap could not grow, will retry */
+#define MM_PRESSURE_WATERMARK 2     /* heap grew past the watermark */
+typedef void (*mm_pressure_callback)(int event, size_t request, void *ctx);
+
+/* mm_release_free_memory levels */
+#define MM_RELEASE_TRIM 0  /* return the free heap top */
+#define MM_RELEASE_PURGE 1 /* also purge pages inside free blocks */
+
+/* mm_heap_walk visitor, given each block's payload and payload size;
+   returning nonzero stops the walk. It must not allocate or free. */
+typedef int (*mm_walk_callback)(void *ptr, size_t size, int allocated,
+                                void *ctx);
+
+/* mm_validate results; negative codes name the first broken invariant */
+#define MM_VALID_OK 0        /* no damage found (a step: more to check) */
+#define MM_VALID_DONE 1      /* mm_validate_step finished a clean pass */
+#define MM_VALID_EDGE -1     /* prologue or epilogue damaged */
+#define MM_VALID_SIZE -2     /* block size misaligned, too small or too big */
+#define MM_VALID_TAGS -3     /* header and footer differ */
+#define MM_VALID_ADJACENT -4 /* two free blocks side by side */
+#define MM_VALID_LINK -5     /* free block not properly on a free list */
+#define MM_VALID_ORDER -6    /* free list out of address order */
+#define MM_VALID_CLASS -7    /* free block on the wrong size class list */
+
+/* handle to a movable allocation, 0 is never a valid handle */
+typedef uint32_t mm_handle_t;
+
 extern int mm_init(void);
+extern int mm_init_locked(size_t reserve);
+extern int mm_config_set(const char *key, const char *value);
+extern int mm_config_load(const char *conf);
 extern void *mm_malloc(uint32_t size);
+extern void *mm_malloc_flags(uint32_t size, int flags);
 extern void mm_free(void *ptr);
 extern void *mm_realloc(void *ptr, uint32_t size);
+extern void *mm_malloc_hint(uint32_t size, int hint);
+extern void *mm_malloc_tagged(uint32_t size, int tag);
+extern void mm_tag_stats(int tag, struct mm_tag_usage *usage);
+extern int mm_should_move(void *ptr);
+extern int mm_comalloc(size_t n, const uint32_t sizes[], void *out[]);
+extern int mm_reserve(uint32_t size, uint32_t count);
+extern void mm_get_stats(struct mm_stats *st);
+extern void mm_set_limit(size_t hard, size_t soft);
+extern void mm_set_limit_handler(mm_limit_handler handler);
+extern void mm_set_pressure_callback(mm_pressure_callback cb, void *ctx);
+extern void mm_set_watermark(size_t bytes);
+extern size_t mm_release_free_memory(int level);
+extern int mm_heap_walk(mm_walk_callback cb, void *ctx);
+extern int mm_heap_walk_step(mm_walk_callback cb, void *ctx,
+                             size_t max_blocks);
+extern int mm_validate(void **bad);
+extern int mm_validate_step(size_t max_blocks, void **bad);
+
+extern mm_handle_t mm_halloc(uint32_t size);
+extern void mm_hfree(mm_handle_t h);
+extern void *mm_hpin(mm_handle_t h);
+extern void mm_hunpin(mm_handle_t h);
+extern size_t mm_hcompact(size_t max_blocks);
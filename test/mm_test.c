@@ -0,0 +1,786 @@
+/*
+ * mm_test.c - Behaviour tests for the segregated allocator's extended API.
+ *
+ * Each test drives one API and checks its results, and after every step
+ * that touches the heap it checks mm_validate() == MM_VALID_OK. The first
+ * failed check prints its line and the program exits with status 1.
+ */
+#include "../mm.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);         \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+// the heap must be intact after every step
+#define VALID()                                                                \
+  do {                                                                         \
+    void *bad = NULL;                                                          \
+    int err = mm_validate(&bad);                                               \
+    if (err != MM_VALID_OK) {                                                  \
+      printf("%s:%d: mm_validate %d at %p\n", __FILE__, __LINE__, err, bad);   \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+// fill and check a payload with a pattern derived from seed
+static void fill(void *p, size_t n, int seed) {
+  for (size_t i = 0; i < n; i++) {
+    ((unsigned char *)p)[i] = (unsigned char)(seed + i);
+  }
+}
+
+static int intact(const void *p, size_t n, int seed) {
+  for (size_t i = 0; i < n; i++) {
+    if (((const unsigned char *)p)[i] != (unsigned char)(seed + i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// back to defaults and a fresh heap; settings outlive mm_init
+static void fresh_heap(void) {
+  CHECK(mm_config_load("fit:first,hot:0,shrink:0,wilderness:0,trim:0,"
+                       "chunk:4k,region:64k") == 0);
+  mm_set_limit(0, 0);
+  mm_set_watermark(0);
+  mm_set_limit_handler(NULL);
+  mm_set_pressure_callback(NULL, NULL);
+  CHECK(mm_init() == 0);
+  VALID();
+}
+
+#define MIX_N 500
+#define MIX_OPS 20000
+
+static void test_malloc_free_realloc(const char *conf) {
+  static void *p[MIX_N];
+  static uint32_t size[MIX_N];
+
+  fresh_heap();
+  CHECK(mm_config_load(conf) == 0);
+  memset(p, 0, sizeof(p));
+  srand(1);
+  for (int op = 0; op < MIX_OPS; op++) {
+    int i = rand() % MIX_N;
+    if (p[i] == NULL) {
+      size[i] = 1 + rand() % 2000;
+      p[i] = mm_malloc(size[i]);
+      CHECK(p[i] != NULL);
+      fill(p[i], size[i], i);
+    } else if (rand() % 3 == 0) {
+      uint32_t keep = size[i];
+      size[i] = 1 + rand() % 2000;
+      keep = keep < size[i] ? keep : size[i];
+      CHECK(intact(p[i], keep, i));
+      p[i] = mm_realloc(p[i], size[i]);
+      CHECK(p[i] != NULL);
+      CHECK(intact(p[i], keep, i));
+      fill(p[i], size[i], i);
+    } else {
+      CHECK(intact(p[i], size[i], i));
+      mm_free(p[i]);
+      p[i] = NULL;
+    }
+    if (op % 50 == 0) {
+      VALID();
+    }
+  }
+  for (int i = 0; i < MIX_N; i++) {
+    if (p[i] != NULL) {
+      CHECK(intact(p[i], size[i], i));
+      mm_free(p[i]);
+    }
+  }
+  VALID();
+}
+
+#define HANDLE_N 200
+
+static void test_handles(void) {
+  mm_handle_t h[HANDLE_N];
+  void *plain[HANDLE_N];
+  struct mm_stats before, after;
+
+  fresh_heap();
+  for (int i = 0; i < HANDLE_N; i++) {
+    h[i] = mm_halloc((uint32_t)(32 + i % 100));
+    CHECK(h[i] != 0);
+    fill(mm_hpin(h[i]), (size_t)(32 + i % 100), i);
+    mm_hunpin(h[i]);
+    plain[i] = mm_malloc(48);
+    CHECK(plain[i] != NULL);
+  }
+  VALID();
+
+  // holes below the handles, one handle kept pinned
+  for (int i = 0; i < HANDLE_N; i++) {
+    mm_free(plain[i]);
+    if (i % 2) {
+      mm_hfree(h[i]);
+      h[i] = 0;
+    }
+  }
+  VALID();
+  void *pinned = mm_hpin(h[10]);
+
+  mm_get_stats(&before);
+  while (mm_hcompact(16) != 0) {
+    VALID();
+  }
+  mm_get_stats(&after);
+  CHECK(after.heap_size <= before.heap_size);
+  CHECK(mm_hpin(h[10]) == pinned); // a pinned block never moves
+  mm_hunpin(h[10]);
+  mm_hunpin(h[10]);
+
+  for (int i = 0; i < HANDLE_N; i += 2) {
+    CHECK(intact(mm_hpin(h[i]), (size_t)(32 + i % 100), i));
+    mm_hunpin(h[i]);
+    mm_hfree(h[i]);
+    VALID();
+  }
+}
+
+#define SPARSE_N 4096
+
+static void test_avoid_sparse(void) {
+  static void *p[SPARSE_N];
+
+  fresh_heap();
+  for (int i = 0; i < SPARSE_N; i++) {
+    p[i] = mm_malloc(56);
+    CHECK(p[i] != NULL);
+  }
+  VALID();
+  CHECK(!mm_should_move(p[SPARSE_N / 2]));
+
+  // empty the first quarter of the blocks, all but one
+  for (int i = 1; i < SPARSE_N / 4; i++) {
+    mm_free(p[i]);
+    p[i] = NULL;
+  }
+  VALID();
+  CHECK(mm_should_move(p[0]));
+  CHECK(!mm_should_move(p[SPARSE_N / 2]));
+
+  // the live heap is recounted for a new region size
+  CHECK(mm_config_set("region", "4k") == 0);
+  CHECK(mm_should_move(p[0]));
+  CHECK(!mm_should_move(p[SPARSE_N / 2]));
+  CHECK(mm_config_set("region", "64k") == 0);
+
+  void *moved = mm_malloc_flags(56, MM_AVOID_SPARSE);
+  CHECK(moved != NULL);
+  CHECK(!mm_should_move(moved));
+  fill(p[0], 56, 7);
+  memcpy(moved, p[0], 56);
+  mm_free(p[0]);
+  CHECK(intact(moved, 56, 7));
+  VALID();
+
+  mm_free(moved);
+  for (int i = SPARSE_N / 4; i < SPARSE_N; i++) {
+    mm_free(p[i]);
+  }
+  VALID();
+}
+
+static void test_tags(void) {
+  struct mm_tag_usage u;
+  void *a, *b, *c;
+
+  fresh_heap();
+  a = mm_malloc_tagged(100, 3);
+  b = mm_malloc_tagged(300, 3);
+  c = mm_malloc_tagged(50, 4);
+  CHECK(a != NULL && b != NULL && c != NULL);
+  VALID();
+  mm_tag_stats(3, &u);
+  CHECK(u.count == 2 && u.bytes >= 400);
+  mm_tag_stats(4, &u);
+  CHECK(u.count == 1 && u.bytes >= 50);
+
+  // resizing keeps the tag and moves its byte count
+  b = mm_realloc(b, 2000);
+  CHECK(b != NULL);
+  VALID();
+  mm_tag_stats(3, &u);
+  CHECK(u.count == 2 && u.bytes >= 2100);
+
+  mm_free(a);
+  mm_free(b);
+  mm_free(c);
+  VALID();
+  mm_tag_stats(3, &u);
+  CHECK(u.count == 0 && u.bytes == 0);
+  mm_tag_stats(4, &u);
+  CHECK(u.count == 0 && u.bytes == 0);
+}
+
+static size_t refused; // last request the limit handler saw
+
+static void on_limit(size_t request) { refused = request; }
+
+static void test_limit(void) {
+  struct mm_stats st;
+  size_t limit;
+  void *p;
+
+  fresh_heap();
+  mm_get_stats(&st);
+  limit = st.heap_size + 16384;
+  mm_set_limit_handler(on_limit);
+  mm_set_limit(limit, 0);
+  refused = 0;
+  CHECK(mm_malloc(1 << 20) == NULL);
+  CHECK(refused >= (1 << 20));
+  VALID();
+
+  p = mm_malloc(1000); // still fits under the limit
+  CHECK(p != NULL);
+  VALID();
+  mm_get_stats(&st);
+  CHECK(st.heap_size <= limit);
+  mm_free(p);
+
+  mm_set_limit(0, 0);
+  p = mm_malloc(1 << 20);
+  CHECK(p != NULL);
+  VALID();
+  mm_free(p);
+  VALID();
+}
+
+struct pressure_log {
+  int watermark; // MM_PRESSURE_WATERMARK events
+  int failed;    // MM_PRESSURE_EXTEND_FAILED events
+};
+
+static void on_pressure(int event, size_t request, void *ctx) {
+  struct pressure_log *log = ctx;
+
+  (void)request;
+  if (event == MM_PRESSURE_WATERMARK) {
+    log->watermark++;
+  } else if (event == MM_PRESSURE_EXTEND_FAILED) {
+    log->failed++;
+    mm_set_limit(0, 0); // make room, so the retry succeeds
+  }
+}
+
+static void test_pressure(void) {
+  struct pressure_log log = {0, 0};
+  struct mm_stats st;
+  uint32_t sizes[3] = {40000, 24, 30000};
+  void *p, *q, *objs[3];
+
+  fresh_heap();
+  mm_set_pressure_callback(on_pressure, &log);
+  mm_get_stats(&st);
+  mm_set_watermark(st.heap_size + 8192);
+  p = mm_malloc(65536);
+  CHECK(p != NULL);
+  CHECK(log.watermark == 1);
+  VALID();
+
+  mm_get_stats(&st);
+  mm_set_limit(st.heap_size, 0);
+  q = mm_malloc(65536);
+  CHECK(q != NULL);
+  CHECK(log.failed == 1);
+  VALID();
+
+  // mm_comalloc takes the same retry and cuts up the block it returns
+  mm_get_stats(&st);
+  mm_set_limit(st.heap_size, 0);
+  CHECK(mm_comalloc(3, sizes, objs) == 0);
+  CHECK(log.failed == 2);
+  for (int k = 0; k < 3; k++) {
+    fill(objs[k], sizes[k], k);
+  }
+  VALID();
+  for (int k = 0; k < 3; k++) {
+    CHECK(intact(objs[k], sizes[k], k));
+    mm_free(objs[k]);
+  }
+  VALID();
+
+  mm_free(p);
+  mm_free(q);
+  CHECK(mm_release_free_memory(MM_RELEASE_PURGE) > 0);
+  VALID();
+}
+
+#define POOL_BYTES (1 << 20)
+
+// a locked pool must fill without a single page fault
+static long page_faults(void) {
+  struct rusage ru;
+
+  CHECK(getrusage(RUSAGE_SELF, &ru) == 0);
+  return ru.ru_minflt + ru.ru_majflt;
+}
+
+static void test_locked_pool(void) {
+  static void *p[POOL_BYTES / 32];
+  struct mm_stats st;
+  int n = 0;
+  long faults;
+
+  fresh_heap();
+  CHECK(mm_init_locked(POOL_BYTES) == 0);
+  VALID();
+  CHECK(mm_malloc_flags(8192, MM_FAILFAST) == NULL); // past the first chunk
+  memset(p, 0, sizeof(p));
+  faults = page_faults();
+  while ((p[n] = mm_malloc(n % 2 ? 1000 : 24)) != NULL) {
+    n++;
+  }
+  for (int i = 1; i < n; i += 2) {
+    mm_free(p[i]); // as many free blocks as the pool can hold
+  }
+  CHECK(page_faults() == faults);
+  VALID();
+  for (int i = 0; i < n; i += 2) {
+    mm_free(p[i]);
+  }
+  n = 0;
+  while ((p[n] = mm_malloc(1000)) != NULL) {
+    fill(p[n], 1000, n);
+    n++;
+  }
+  VALID();
+
+  // the pool is spent: nothing fits and the heap cannot grow past it
+  CHECK(n > POOL_BYTES / 1024 * 9 / 10);
+  CHECK(mm_malloc_flags(1000, MM_FAILFAST) == NULL);
+  mm_get_stats(&st);
+  CHECK(st.heap_size <= POOL_BYTES);
+
+  for (int i = 0; i < n; i++) {
+    CHECK(intact(p[i], 1000, i));
+    mm_free(p[i]);
+  }
+  VALID();
+  CHECK(mm_malloc_flags(POOL_BYTES / 2, MM_FAILFAST) != NULL);
+  VALID();
+  CHECK(mm_init() == 0); // back to sbrk
+}
+
+static void trim_on_watermark(int event, size_t request, void *ctx) {
+  (void)request;
+  (void)ctx;
+  if (event == MM_PRESSURE_WATERMARK) {
+    mm_release_free_memory(MM_RELEASE_TRIM);
+  }
+}
+
+static void test_wilderness(void) {
+  struct mm_stats st;
+  void *low, *big, *top, *p;
+
+  fresh_heap();
+  CHECK(mm_config_set("wilderness", "1") == 0);
+  low = mm_malloc(100);
+  big = mm_malloc(65536);
+  top = mm_malloc(100);
+  mm_free(top);
+  CHECK(low != NULL && big != NULL);
+  VALID();
+
+  // a hole below the top: small requests go there, not to the top block
+  mm_free(low);
+  p = mm_malloc(50);
+  CHECK(p == low);
+  VALID();
+
+  // a 64 KB free top that the watermark callback trims away while the
+  // heap grows by the top block's shortfall
+  mm_free(big);
+  VALID();
+  mm_get_stats(&st);
+  mm_set_watermark(st.heap_size + 1);
+  mm_set_pressure_callback(trim_on_watermark, NULL);
+  big = mm_malloc(100000);
+  CHECK(big != NULL);
+  fill(big, 100000, 1);
+  VALID();
+  mm_free(big);
+  mm_free(p);
+  VALID();
+}
+
+#define RESERVE_N 100
+
+struct sized_count {
+  size_t size;
+  int count;
+};
+
+static int count_free_sized(void *ptr, size_t size, int allocated,
+                            void *ctx) {
+  struct sized_count *c = ctx;
+
+  (void)ptr;
+  c->count += !allocated && size == c->size;
+  return 0;
+}
+
+static void test_reserve(void) {
+  void *p[RESERVE_N];
+  struct mm_stats before, after;
+
+  // a small request next to a lone reserved block
+  fresh_heap();
+  CHECK(mm_reserve(48, 1) == 0);
+  CHECK(mm_malloc(8) != NULL);
+  VALID();
+
+  fresh_heap();
+  CHECK(mm_reserve(48, RESERVE_N) == 0);
+  VALID();
+  CHECK(mm_reserve(200, 10) == 0);
+  VALID();
+
+  mm_get_stats(&before);
+  for (int i = 0; i < RESERVE_N; i++) {
+    p[i] = mm_malloc(48);
+    CHECK(p[i] != NULL);
+    fill(p[i], 48, i);
+    VALID();
+  }
+  mm_get_stats(&after);
+  CHECK(after.heap_size == before.heap_size);
+
+  // a reserved block is never split for a smaller request
+  void *small = mm_malloc(8);
+  CHECK(small != NULL);
+  VALID();
+
+  for (int i = 0; i < RESERVE_N; i++) {
+    CHECK(intact(p[i], 48, i));
+    mm_free(p[i]);
+    VALID();
+  }
+  mm_free(small);
+  mm_release_free_memory(MM_RELEASE_TRIM); // frees the 200-byte reserve
+  VALID();
+
+  // two sizes of one class: the 400-byte run is on top of the 300-byte one
+  struct sized_count left = {320 - 16, 0};
+  fresh_heap();
+  CHECK(mm_reserve(300, 4) == 0);
+  CHECK(mm_reserve(400, 4) == 0);
+  VALID();
+  mm_get_stats(&before);
+  for (int i = 0; i < 4; i++) {
+    p[2 * i] = mm_malloc(300);
+    p[2 * i + 1] = mm_malloc(400);
+    CHECK(p[2 * i] != NULL && p[2 * i + 1] != NULL);
+    VALID();
+  }
+  mm_get_stats(&after);
+  CHECK(after.heap_size == before.heap_size);
+  CHECK(mm_heap_walk(count_free_sized, &left) == 0);
+  CHECK(left.count == 0); // every 300-byte request took a reserved block
+  for (int i = 0; i < 8; i++) {
+    mm_free(p[i]);
+  }
+  VALID();
+}
+
+static void test_config(void) {
+  void *p;
+
+  fresh_heap();
+  CHECK(mm_config_load("chunk:8k,trim:64k,fit:next,hot:4") == 0);
+  CHECK(mm_config_load("fit:worst") == -1);
+  CHECK(mm_config_load("nosuchkey:1") == -1);
+  CHECK(mm_config_load("hot:99") == -1);
+  CHECK(mm_config_load("shrink:25,wilderness:1") == 0);
+  CHECK(mm_config_load("classes:32/64/128/256/512/1024/4096") == 0);
+  VALID();
+  p = mm_malloc(700);
+  CHECK(p != NULL);
+  VALID();
+  p = mm_realloc(p, 600); // within 25%: kept in place
+  VALID();
+  mm_free(mm_malloc(40)); // leave a hot block and a reserved one behind
+  CHECK(mm_reserve(200, 1) == 0);
+  CHECK(mm_config_load("classes:16/32/64/128/256/512/1024/2048/4096/8192/"
+                       "16384") == 0);
+  VALID();
+  mm_free(p);
+  VALID();
+}
+
+#define COMALLOC_N 200
+
+static void test_comalloc(void) {
+  void *objs[COMALLOC_N][3];
+  uint32_t sizes[3] = {48, 300, 100};
+
+  fresh_heap();
+  for (int i = 0; i < COMALLOC_N; i++) {
+    CHECK(mm_comalloc(3, sizes, objs[i]) == 0);
+    for (int k = 0; k < 3; k++) {
+      fill(objs[i][k], sizes[k], i + k);
+    }
+    mm_free(objs[i][2]);
+    VALID();
+  }
+  for (int i = 0; i < COMALLOC_N; i++) {
+    CHECK(intact(objs[i][0], sizes[0], i));
+    CHECK(intact(objs[i][1], sizes[1], i + 1));
+    mm_free(objs[i][1]);
+    mm_free(objs[i][0]);
+    VALID();
+  }
+  sizes[1] = 0;
+  CHECK(mm_comalloc(3, sizes, objs[0]) == -1);
+}
+
+static void test_cache_align(void) {
+  void *p[64];
+
+  fresh_heap();
+  for (int i = 0; i < 64; i++) {
+    p[i] = mm_malloc_flags((uint32_t)(1 + i * 7), MM_CACHE_ALIGN);
+    CHECK(p[i] != NULL && (uintptr_t)p[i] % 64 == 0);
+    VALID();
+  }
+  for (int i = 0; i < 64; i += 2) {
+    p[i] = mm_realloc(p[i], 1000);
+    CHECK(p[i] != NULL && (uintptr_t)p[i] % 64 == 0);
+    VALID();
+  }
+  for (int i = 0; i < 64; i++) {
+    mm_free(p[i]);
+    VALID();
+  }
+}
+
+static int count_live(void *ptr, size_t size, int allocated, void *ctx) {
+  (void)ptr;
+  (void)size;
+  *(int *)ctx += allocated;
+  return 0;
+}
+
+static void test_heap_walk(void) {
+  void *p[300];
+  int live = 0;
+
+  fresh_heap();
+  for (int i = 0; i < 300; i++) {
+    p[i] = mm_malloc((uint32_t)(16 + i));
+  }
+  for (int i = 0; i < 300; i += 3) {
+    mm_free(p[i]);
+  }
+  CHECK(mm_heap_walk(count_live, &live) == 0);
+  CHECK(live == 200);
+  for (int i = 1; i < 300; i++) {
+    if (i % 3 != 0) {
+      mm_free(p[i]);
+    }
+  }
+  VALID();
+
+  // hot blocks are reported free, and the walk leaves them hot
+  fresh_heap();
+  CHECK(mm_config_set("hot", "8") == 0);
+  for (int i = 0; i < 3; i++) {
+    p[i] = mm_malloc(48);
+  }
+  mm_free(p[0]);
+  mm_free(p[1]);
+  live = 0;
+  CHECK(mm_heap_walk(count_live, &live) == 0);
+  CHECK(live == 1);
+  CHECK(mm_malloc(48) == p[1]); // flushed, first fit would give p[0]
+  VALID();
+}
+
+#define WALK_N 300
+
+struct walk_log {
+  void *ptr[4 * WALK_N];
+  int allocated[4 * WALK_N];
+  int n;
+};
+
+static int log_block(void *ptr, size_t size, int allocated, void *ctx) {
+  struct walk_log *log = ctx;
+
+  (void)size;
+  CHECK(log->n < 4 * WALK_N);
+  log->ptr[log->n] = ptr;
+  log->allocated[log->n++] = allocated;
+  return 0;
+}
+
+static void test_heap_walk_step(void) {
+  static struct walk_log log;
+  void *p[WALK_N];
+  int steps = 0, found;
+
+  fresh_heap();
+  for (int i = 0; i < WALK_N; i++) {
+    p[i] = mm_malloc(48);
+  }
+  log.n = 0;
+  CHECK(mm_heap_walk_step(log_block, &log, WALK_N / 2) == 0);
+  CHECK(log.ptr[log.n - 1] == p[WALK_N / 2 - 2]); // prologue not reported
+
+  // free every odd block, and a run around the resume point so it merges
+  // with the blocks on both sides
+  for (int i = 1; i < WALK_N; i += 2) {
+    mm_free(p[i]);
+  }
+  for (int i = WALK_N / 2 - 10; i < WALK_N / 2 + 10; i++) {
+    if (i % 2 == 0) {
+      mm_free(p[i]);
+    }
+  }
+  VALID();
+  while (mm_heap_walk_step(log_block, &log, 7) == 0) {
+    CHECK(++steps < WALK_N);
+  }
+
+  // every block live throughout was seen allocated exactly once, and every
+  // block seen after the frees was a block of the heap at the time
+  for (int i = 0; i < WALK_N; i += 2) {
+    if (i >= WALK_N / 2 - 10 && i < WALK_N / 2 + 10) {
+      continue;
+    }
+    found = 0;
+    for (int k = 0; k < log.n; k++) {
+      found += log.ptr[k] == p[i] && log.allocated[k];
+    }
+    CHECK(found == 1);
+  }
+  for (int k = 0; k < log.n; k++) {
+    found = 0;
+    for (int i = 0; i < WALK_N; i++) {
+      found |= log.ptr[k] == p[i];
+    }
+    CHECK(found);
+  }
+  for (int i = 0; i < WALK_N; i += 2) {
+    if (i < WALK_N / 2 - 10 || i >= WALK_N / 2 + 10) {
+      mm_free(p[i]);
+    }
+  }
+  VALID();
+}
+
+// mm.c boundary tags: a header word in front of the payload and the same
+// word as footer at the end, the block size in bits 3..47, bit 0 allocated
+static uint64_t *header(void *bp) { return (uint64_t *)bp - 1; }
+
+static uint64_t *footer(void *bp) {
+  return (uint64_t *)((char *)bp + (*header(bp) & 0xfffffffffff8ULL)) - 2;
+}
+
+// mm_validate finds each kind of damage and points at the damaged block
+static void test_validate_damage(void) {
+  void *p[5], *bad;
+  uint64_t word;
+
+  fresh_heap();
+  for (int i = 0; i < 5; i++) {
+    p[i] = mm_malloc(48);
+  }
+  mm_free(p[3]);
+  VALID();
+
+  // a footer that no longer matches its header
+  word = *footer(p[1]);
+  *footer(p[1]) ^= 0x40;
+  bad = NULL;
+  CHECK(mm_validate(&bad) == MM_VALID_TAGS && bad == p[1]);
+  *footer(p[1]) = word;
+  VALID();
+
+  // a free block whose list link points out of the heap
+  word = *(uint64_t *)p[3];
+  *(uintptr_t *)p[3] = (uintptr_t)&word;
+  bad = NULL;
+  CHECK(mm_validate(&bad) == MM_VALID_LINK && bad == p[3]);
+  *(uint64_t *)p[3] = word;
+  VALID();
+
+  // an allocated block that lost its allocated bit, next to a free one
+  *header(p[2]) &= ~1ULL;
+  *footer(p[2]) &= ~1ULL;
+  bad = NULL;
+  CHECK(mm_validate(&bad) == MM_VALID_ADJACENT && bad == p[2]);
+  *header(p[2]) |= 1;
+  *footer(p[2]) |= 1;
+  VALID();
+
+  for (int i = 0; i < 5; i++) {
+    if (i != 3) {
+      mm_free(p[i]);
+    }
+  }
+  VALID();
+}
+
+static void test_validate_steps(void) {
+  void *p[300];
+  int steps = 0, r;
+
+  fresh_heap();
+  for (int i = 0; i < 300; i++) {
+    p[i] = mm_malloc((uint32_t)(16 + i));
+  }
+  for (int i = 0; i < 300; i += 3) {
+    mm_free(p[i]);
+  }
+  while ((r = mm_validate_step(16, NULL)) == MM_VALID_OK) {
+    steps++;
+  }
+  CHECK(r == MM_VALID_DONE && steps > 0);
+  for (int i = 1; i < 300; i++) {
+    if (i % 3 != 0) {
+      mm_free(p[i]);
+    }
+  }
+  VALID();
+}
+
+int main(void) {
+  test_malloc_free_realloc("fit:first");
+  test_malloc_free_realloc("fit:best");
+  test_malloc_free_realloc("fit:next,hot:8");
+  test_malloc_free_realloc("shrink:30,wilderness:1");
+  test_handles();
+  test_avoid_sparse();
+  test_tags();
+  test_limit();
+  test_pressure();
+  test_locked_pool();
+  test_wilderness();
+  test_reserve();
+  test_config();
+  test_comalloc();
+  test_cache_align();
+  test_heap_walk();
+  test_heap_walk_step();
+  test_validate_damage();
+  test_validate_steps();
+  printf("mm_test: all tests passed\n");
+  return 0;
+}
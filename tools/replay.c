@@ -0,0 +1,78 @@
+/*
+ * replay.c - replay an allocation trace (see trace.h) against mm.c and
+ * report peak memory utilization and throughput
+ *
+ *   ./tools/replay.out trace.txt
+ *
+ * Utilization is the peak sum of live requested bytes over the peak heap
+ * size. mm.c grows its heap with sbrk, so the trace is loaded before
+ * mm_init and nothing else allocates until the replay is done.
+ */
+#include "../mm.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+  struct trace t;
+  struct mm_stats st;
+  void **ptrs;
+  uint32_t *sizes;
+  size_t live = 0, peak_live = 0, peak_heap = 0;
+  double start, end;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s trace\n", argv[0]);
+    return 1;
+  }
+  if (trace_load(argv[1], &t) == -1) {
+    fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  ptrs = calloc(t.num_ids, sizeof(*ptrs));
+  sizes = calloc(t.num_ids, sizeof(*sizes));
+  if (ptrs == NULL || sizes == NULL || mm_init() == -1) {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    return 1;
+  }
+
+  start = now_sec();
+  for (size_t i = 0; i < t.num_ops; i++) {
+    struct trace_op *op = &t.ops[i];
+
+    if (op->op == 'a') {
+      ptrs[op->id] = mm_malloc(op->size);
+      live += op->size;
+    } else if (op->op == 'r') {
+      ptrs[op->id] = mm_realloc(ptrs[op->id], op->size);
+      live += op->size - sizes[op->id];
+    } else {
+      mm_free(ptrs[op->id]);
+      ptrs[op->id] = NULL;
+      live -= sizes[op->id];
+    }
+    sizes[op->id] = op->op == 'f' ? 0 : op->size;
+    if (op->op != 'f' && ptrs[op->id] == NULL && op->size != 0) {
+      fprintf(stderr, "%s: allocation failed at op %zu\n", argv[0], i);
+      return 1;
+    }
+
+    mm_get_stats(&st);
+    peak_live = live > peak_live ? live : peak_live;
+    peak_heap = st.heap_size > peak_heap ? st.heap_size : peak_heap;
+  }
+  end = now_sec();
+
+  printf("%s: %zu ops, %.6f sec\n", argv[1], t.num_ops, end - start);
+  printf("peak live %zu bytes, peak heap %zu bytes, utilization %.1f%%\n",
+         peak_live, peak_heap, 100.0 * peak_live / peak_heap);
+  return 0;
+}
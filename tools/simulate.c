@@ -0,0 +1,905 @@
+/*
+ * simulate.c - offline placement policy simulator
+ *
+ * Replays an allocation trace (see trace.h) against models of mm.c that
+ * keep only block metadata: address, size, allocated bit and address-order
+ * neighbours. No payload memory is touched. The trace is parsed once, a
+ * batch of operations at a time, and every policy replays each batch, so
+ * memory use grows with the number of live objects rather than the trace
+ * length:
+ *
+ *   ./tools/simulate.out [-p policy]... trace
+ *
+ * A policy is a comma separated list of settings (defaults in brackets):
+ *
+ *   fit=first|best|next     placement within a size class       [first]
+ *   order=addr|lifo         free-list insertion order           [addr]
+ *   classes=32/64/...       class bounds, 1 = a single list     [mm.c's]
+ *   split=N                 smallest remainder worth splitting  [32]
+ *   chunk=N                 heap extension step                 [4096]
+ *
+ * Without -p, every fit/order combination is run with the defaults. Each
+ * run reports peak heap, fragmentation (1 - peak live / peak heap) and
+ * free-list probes: the blocks mm.c would step through searching for fits
+ * and insertion points. Frees and reallocs of ids that are not live, and
+ * allocations of ids that are, break the trace contract and are skipped
+ * and counted.
+ *
+ * The model does not walk its free lists to count probes. Like mm.c's side
+ * table, each list is a run of leaves holding up to LEAF_N blocks in list
+ * order with their keys and sizes packed, and a directory keeps each
+ * leaf's block count and largest size. A fit skips whole leaves by their
+ * largest size, a probe count is the position of a block in its list, and
+ * best fit looks the smallest fitting size up in the class's size bins.
+ */
+#include "trace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// must match mm.c
+#define NUM_FREE_LISTS 12
+#define MINBLOCKSIZE 32
+#define OVERHEAD 16
+#define ALIGNMENT 8
+#define HEAP_START 32 // padding, prologue and epilogue
+
+#define FIT_FIRST 0
+#define FIT_BEST 1
+#define FIT_NEXT 2
+
+#define NIL (-1)
+#define LEAF_N 64   // blocks per leaf
+#define BATCH 65536 // trace operations parsed at a time
+
+struct policy {
+  const char *spec;
+  int fit;
+  int lifo;
+  int num_lists;
+  uint64_t limits[NUM_FREE_LISTS - 1];
+  uint64_t split;
+  uint64_t chunk;
+};
+
+// a block of the modelled heap; blocks are linked in address order
+struct block {
+  uint64_t addr;
+  uint64_t size;
+  uint64_t key; // place on its free list: the address, or a LIFO stamp
+  int32_t prev, next;
+  int32_t alloc;
+};
+
+// up to LEAF_N free blocks of one list, ascending by key
+struct leaf {
+  uint64_t keys[LEAF_N];
+  uint64_t sizes[LEAF_N];
+  int32_t blocks[LEAF_N];
+  struct leaf *next_unused;
+};
+
+// a directory entry: one leaf and what a search needs to know about it
+struct leaf_ref {
+  struct leaf *leaf;
+  uint64_t first; // smallest key
+  uint64_t max;   // largest size
+  uint32_t count;
+};
+
+struct free_list {
+  struct leaf_ref *refs; // in list order
+  int num_refs, cap_refs;
+  uint32_t count;
+  // size bins for best fit: the distinct sizes on the list, ascending,
+  // and how many blocks have each
+  uint64_t *bin_sizes;
+  uint32_t *bin_counts;
+  int num_bins, cap_bins;
+  int has_rover; // next fit resumes at the first block keyed >= rover
+  uint64_t rover;
+};
+
+// one policy's model of the heap
+struct sim {
+  struct policy pol;
+  struct block *blocks;
+  int32_t num_blocks, unused_blocks; // pool size, head of unused chain
+  int32_t top;                       // highest-addressed block
+  struct free_list lists[NUM_FREE_LISTS];
+  uint64_t heap_size, peak_heap, stamp;
+  uint64_t fit_probes, insert_probes;
+  int32_t *objs; // block of each live id, NIL otherwise
+  double seconds;
+};
+
+static struct leaf *unused_leaves;
+
+// requested bytes of each id and whether it is live; the same under every
+// policy, so kept once
+static uint32_t *sizes;
+static uint8_t *live_ids;
+static uint32_t num_ids;
+
+static void *xrealloc(void *p, size_t bytes) {
+  if ((p = realloc(p, bytes)) == NULL) {
+    fprintf(stderr, "simulate: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static uint64_t block_size(uint64_t size) {
+  if (size <= ALIGNMENT) {
+    return MINBLOCKSIZE;
+  }
+  return (size + OVERHEAD + ALIGNMENT - 1) & ~(uint64_t)(ALIGNMENT - 1);
+}
+
+static int list_index(const struct sim *s, uint64_t size) {
+  for (int i = 0; i < s->pol.num_lists - 1; i++) {
+    if (size <= s->pol.limits[i]) {
+      return i;
+    }
+  }
+  return s->pol.num_lists - 1;
+}
+
+//
+// Free lists. A position on a list is a directory index and an index into
+// that leaf; (num_refs, 0) is the end of the list.
+//
+
+static struct leaf *new_leaf(void) {
+  struct leaf *leaf = unused_leaves;
+
+  if (leaf == NULL) {
+    return xrealloc(NULL, sizeof(*leaf));
+  }
+  unused_leaves = leaf->next_unused;
+  return leaf;
+}
+
+static uint64_t leaf_max(const struct leaf *leaf, uint32_t count) {
+  uint64_t max = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    max = leaf->sizes[i] > max ? leaf->sizes[i] : max;
+  }
+  return max;
+}
+
+// make room for a directory entry at r
+static void open_ref(struct free_list *l, int r) {
+  if (l->num_refs == l->cap_refs) {
+    l->cap_refs = l->cap_refs ? 2 * l->cap_refs : 4;
+    l->refs = xrealloc(l->refs, l->cap_refs * sizeof(*l->refs));
+  }
+  memmove(&l->refs[r + 1], &l->refs[r], (l->num_refs - r) * sizeof(*l->refs));
+  l->num_refs++;
+}
+
+// drop directory entry r and keep its leaf for reuse
+static void close_ref(struct free_list *l, int r) {
+  l->refs[r].leaf->next_unused = unused_leaves;
+  unused_leaves = l->refs[r].leaf;
+  l->num_refs--;
+  memmove(&l->refs[r], &l->refs[r + 1], (l->num_refs - r) * sizeof(*l->refs));
+}
+
+// the leaf that holds key, or would: the last one starting at or below it
+static int find_ref(const struct free_list *l, uint64_t key) {
+  int lo = 0, hi = l->num_refs - 1;
+
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (l->refs[mid].first <= key) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+// index in ref's leaf of the first key >= key
+static uint32_t find_entry(const struct leaf_ref *ref, uint64_t key) {
+  uint32_t lo = 0, hi = ref->count;
+
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (ref->leaf->keys[mid] < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// position of the first block keyed >= key
+static void seek(const struct free_list *l, uint64_t key, int *r,
+                 uint32_t *i) {
+  *r = 0;
+  *i = 0;
+  if (l->num_refs > 0) {
+    *r = find_ref(l, key);
+    *i = find_entry(&l->refs[*r], key);
+    if (*i == l->refs[*r].count) {
+      (*r)++;
+      *i = 0;
+    }
+  }
+}
+
+// blocks ahead of position (r, i) in list order
+static uint64_t rank(const struct free_list *l, int r, uint32_t i) {
+  uint64_t n = i;
+
+  for (int k = 0; k < r; k++) {
+    n += l->refs[k].count;
+  }
+  return n;
+}
+
+// move (*r, *i) to the first block there or later of at least asize
+// bytes; returns 0 if there is none
+static int fit_from(const struct free_list *l, uint64_t asize, int *r,
+                    uint32_t *i) {
+  for (int k = *r; k < l->num_refs; k++) {
+    const struct leaf_ref *ref = &l->refs[k];
+
+    if (ref->max < asize) {
+      continue;
+    }
+    for (uint32_t j = k == *r ? *i : 0; j < ref->count; j++) {
+      if (ref->leaf->sizes[j] >= asize) {
+        *r = k;
+        *i = j;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+// position of the first block of exactly size bytes, which must exist
+static void find_size(const struct free_list *l, uint64_t size, int *r,
+                      uint32_t *i) {
+  for (int k = 0;; k++) {
+    const struct leaf_ref *ref = &l->refs[k];
+
+    if (ref->max < size) {
+      continue;
+    }
+    for (uint32_t j = 0; j < ref->count; j++) {
+      if (ref->leaf->sizes[j] == size) {
+        *r = k;
+        *i = j;
+        return;
+      }
+    }
+  }
+}
+
+// first size bin of at least size bytes
+static int find_bin(const struct free_list *l, uint64_t size) {
+  int lo = 0, hi = l->num_bins;
+
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (l->bin_sizes[mid] < size) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static void bin_add(struct free_list *l, uint64_t size) {
+  int b = find_bin(l, size);
+
+  if (b < l->num_bins && l->bin_sizes[b] == size) {
+    l->bin_counts[b]++;
+    return;
+  }
+  if (l->num_bins == l->cap_bins) {
+    l->cap_bins = l->cap_bins ? 2 * l->cap_bins : 16;
+    l->bin_sizes = xrealloc(l->bin_sizes, l->cap_bins * sizeof(uint64_t));
+    l->bin_counts = xrealloc(l->bin_counts, l->cap_bins * sizeof(uint32_t));
+  }
+  memmove(&l->bin_sizes[b + 1], &l->bin_sizes[b],
+          (l->num_bins - b) * sizeof(uint64_t));
+  memmove(&l->bin_counts[b + 1], &l->bin_counts[b],
+          (l->num_bins - b) * sizeof(uint32_t));
+  l->bin_sizes[b] = size;
+  l->bin_counts[b] = 1;
+  l->num_bins++;
+}
+
+static void bin_remove(struct free_list *l, uint64_t size) {
+  int b = find_bin(l, size);
+
+  if (--l->bin_counts[b] == 0) {
+    l->num_bins--;
+    memmove(&l->bin_sizes[b], &l->bin_sizes[b + 1],
+            (l->num_bins - b) * sizeof(uint64_t));
+    memmove(&l->bin_counts[b], &l->bin_counts[b + 1],
+            (l->num_bins - b) * sizeof(uint32_t));
+  }
+}
+
+// put block b on list l under key; returns the blocks ahead of it, which
+// mm.c would step over to find the spot
+static uint64_t list_insert(struct free_list *l, uint64_t key, uint64_t size,
+                            int32_t b) {
+  struct leaf_ref *ref;
+  uint32_t i;
+  int r;
+
+  if (l->num_refs == 0) {
+    open_ref(l, 0);
+    l->refs[0] = (struct leaf_ref){new_leaf(), key, 0, 0};
+  }
+  r = find_ref(l, key);
+  if (l->refs[r].count == LEAF_N) {
+    // move the upper half to a new leaf
+    struct leaf *old = l->refs[r].leaf, *leaf = new_leaf();
+    uint32_t half = LEAF_N / 2;
+    memcpy(leaf->keys, &old->keys[half], half * sizeof(uint64_t));
+    memcpy(leaf->sizes, &old->sizes[half], half * sizeof(uint64_t));
+    memcpy(leaf->blocks, &old->blocks[half], half * sizeof(int32_t));
+    open_ref(l, r + 1);
+    l->refs[r].count = half;
+    l->refs[r].max = leaf_max(old, half);
+    l->refs[r + 1] =
+        (struct leaf_ref){leaf, leaf->keys[0], leaf_max(leaf, half), half};
+    if (key >= leaf->keys[0]) {
+      r++;
+    }
+  }
+  ref = &l->refs[r];
+  i = find_entry(ref, key);
+  memmove(&ref->leaf->keys[i + 1], &ref->leaf->keys[i],
+          (ref->count - i) * sizeof(uint64_t));
+  memmove(&ref->leaf->sizes[i + 1], &ref->leaf->sizes[i],
+          (ref->count - i) * sizeof(uint64_t));
+  memmove(&ref->leaf->blocks[i + 1], &ref->leaf->blocks[i],
+          (ref->count - i) * sizeof(int32_t));
+  ref->leaf->keys[i] = key;
+  ref->leaf->sizes[i] = size;
+  ref->leaf->blocks[i] = b;
+  ref->count++;
+  ref->first = ref->leaf->keys[0];
+  ref->max = size > ref->max ? size : ref->max;
+  l->count++;
+  return rank(l, r, i);
+}
+
+// append leaf r + 1 to leaf r
+static void merge_refs(struct free_list *l, int r) {
+  struct leaf_ref *ref = &l->refs[r], *next = &l->refs[r + 1];
+
+  memcpy(&ref->leaf->keys[ref->count], next->leaf->keys,
+         next->count * sizeof(uint64_t));
+  memcpy(&ref->leaf->sizes[ref->count], next->leaf->sizes,
+         next->count * sizeof(uint64_t));
+  memcpy(&ref->leaf->blocks[ref->count], next->leaf->blocks,
+         next->count * sizeof(int32_t));
+  ref->count += next->count;
+  ref->max = next->max > ref->max ? next->max : ref->max;
+  close_ref(l, r + 1);
+}
+
+// take the block under key, of size bytes, off list l
+static void list_delete(struct free_list *l, uint64_t key, uint64_t size) {
+  int r = find_ref(l, key);
+  struct leaf_ref *ref = &l->refs[r];
+  uint32_t i = find_entry(ref, key);
+
+  ref->count--;
+  memmove(&ref->leaf->keys[i], &ref->leaf->keys[i + 1],
+          (ref->count - i) * sizeof(uint64_t));
+  memmove(&ref->leaf->sizes[i], &ref->leaf->sizes[i + 1],
+          (ref->count - i) * sizeof(uint64_t));
+  memmove(&ref->leaf->blocks[i], &ref->leaf->blocks[i + 1],
+          (ref->count - i) * sizeof(int32_t));
+  l->count--;
+  if (ref->count == 0) {
+    close_ref(l, r);
+  } else {
+    ref->first = ref->leaf->keys[0];
+    if (size == ref->max) {
+      ref->max = leaf_max(ref->leaf, ref->count);
+    }
+    // merge sparse neighbours so the directory stays short
+    if (r + 1 < l->num_refs &&
+        ref->count + l->refs[r + 1].count <= LEAF_N / 2) {
+      merge_refs(l, r);
+    } else if (r > 0 && l->refs[r - 1].count + ref->count <= LEAF_N / 2) {
+      merge_refs(l, r - 1);
+    }
+  }
+
+  // as in mm.c, a deleted rover passes to the next block on the list
+  if (l->has_rover && l->rover == key) {
+    seek(l, key, &r, &i);
+    l->has_rover = r < l->num_refs;
+    if (l->has_rover) {
+      l->rover = l->refs[r].leaf->keys[i];
+    }
+  }
+}
+
+//
+// The heap model
+//
+
+static int32_t new_block(struct sim *s, uint64_t addr, uint64_t size) {
+  int32_t b = s->unused_blocks;
+
+  if (b == NIL) {
+    int32_t cap = s->num_blocks ? 2 * s->num_blocks : 1024;
+    s->blocks = xrealloc(s->blocks, cap * sizeof(*s->blocks));
+    for (int32_t i = s->num_blocks; i < cap; i++) {
+      s->blocks[i].next = (i + 1 < cap) ? i + 1 : NIL;
+    }
+    b = s->num_blocks;
+    s->num_blocks = cap;
+  }
+  s->unused_blocks = s->blocks[b].next;
+  s->blocks[b].addr = addr;
+  s->blocks[b].size = size;
+  s->blocks[b].prev = s->blocks[b].next = NIL;
+  s->blocks[b].alloc = 0;
+  return b;
+}
+
+static void drop_block(struct sim *s, int32_t b) {
+  s->blocks[b].next = s->unused_blocks;
+  s->unused_blocks = b;
+}
+
+static void insert_free(struct sim *s, int32_t b) {
+  struct block *bk = &s->blocks[b];
+  struct free_list *l = &s->lists[list_index(s, bk->size)];
+
+  // LIFO keys count down, so each block goes in front of its list
+  bk->key = s->pol.lifo ? UINT64_MAX - s->stamp++ : bk->addr;
+  s->insert_probes += list_insert(l, bk->key, bk->size, b);
+  if (s->pol.fit == FIT_BEST) {
+    bin_add(l, bk->size);
+  }
+}
+
+static void delete_free(struct sim *s, int32_t b) {
+  struct block *bk = &s->blocks[b];
+  struct free_list *l = &s->lists[list_index(s, bk->size)];
+
+  list_delete(l, bk->key, bk->size);
+  if (s->pol.fit == FIT_BEST) {
+    bin_remove(l, bk->size);
+  }
+}
+
+//
+// find_fit - The block mm.c's find_fit would pick, adding the probes its
+// list walk would take
+//
+static int32_t find_fit(struct sim *s, uint64_t asize) {
+  for (int c = list_index(s, asize); c < s->pol.num_lists; c++) {
+    struct free_list *l = &s->lists[c];
+    uint64_t from;
+    uint32_t i = 0;
+    int r = 0;
+
+    if (s->pol.fit == FIT_BEST) {
+      // an exact fit ends the walk, anything else is found by a full one
+      int bin = find_bin(l, asize);
+      if (bin == l->num_bins) {
+        s->fit_probes += l->count;
+        continue;
+      }
+      find_size(l, l->bin_sizes[bin], &r, &i);
+      s->fit_probes +=
+          l->bin_sizes[bin] == asize ? rank(l, r, i) + 1 : l->count;
+      return l->refs[r].leaf->blocks[i];
+    }
+    if (s->pol.fit == FIT_NEXT && l->has_rover) {
+      // resume at the rover, wrapping around to the head once
+      seek(l, l->rover, &r, &i);
+      from = rank(l, r, i);
+      if (fit_from(l, asize, &r, &i)) {
+        s->fit_probes += rank(l, r, i) - from + 1;
+      } else {
+        r = 0;
+        i = 0;
+        if (!fit_from(l, asize, &r, &i)) {
+          s->fit_probes += l->count;
+          continue;
+        }
+        s->fit_probes += l->count - from + rank(l, r, i) + 1;
+      }
+    } else if (fit_from(l, asize, &r, &i)) {
+      s->fit_probes += rank(l, r, i) + 1;
+    } else {
+      s->fit_probes += l->count;
+      continue;
+    }
+    if (s->pol.fit == FIT_NEXT) {
+      l->rover = l->refs[r].leaf->keys[i];
+      l->has_rover = 1;
+    }
+    return l->refs[r].leaf->blocks[i];
+  }
+  return NIL;
+}
+
+// link block nb into address order right after b
+static void link_after(struct sim *s, int32_t b, int32_t nb) {
+  struct block *blocks = s->blocks;
+
+  blocks[nb].prev = b;
+  blocks[nb].next = blocks[b].next;
+  if (blocks[b].next != NIL) {
+    blocks[blocks[b].next].prev = nb;
+  } else {
+    s->top = nb;
+  }
+  blocks[b].next = nb;
+}
+
+// absorb the next block (free, already off its list) into b
+static void absorb_next(struct sim *s, int32_t b) {
+  struct block *blocks = s->blocks;
+  int32_t n = blocks[b].next;
+
+  blocks[b].size += blocks[n].size;
+  blocks[b].next = blocks[n].next;
+  if (blocks[n].next != NIL) {
+    blocks[blocks[n].next].prev = b;
+  } else {
+    s->top = b;
+  }
+  drop_block(s, n);
+}
+
+static int32_t coalesce(struct sim *s, int32_t b) {
+  int32_t n = s->blocks[b].next, p = s->blocks[b].prev;
+
+  if (n != NIL && !s->blocks[n].alloc) {
+    delete_free(s, n);
+    absorb_next(s, b);
+  }
+  if (p != NIL && !s->blocks[p].alloc) {
+    delete_free(s, p);
+    absorb_next(s, p);
+    b = p;
+  }
+  insert_free(s, b);
+  return b;
+}
+
+static int32_t extend_heap(struct sim *s, uint64_t size) {
+  int32_t b = new_block(s, s->heap_size, size);
+
+  s->heap_size += size;
+  if (s->heap_size > s->peak_heap) {
+    s->peak_heap = s->heap_size;
+  }
+  if (s->top != NIL) {
+    link_after(s, s->top, b);
+  } else {
+    s->top = b;
+  }
+  return coalesce(s, b);
+}
+
+// split b (allocated or off-list) to asize if the remainder is worth it;
+// returns the remainder or NIL
+static int32_t split(struct sim *s, int32_t b, uint64_t asize) {
+  uint64_t rest = s->blocks[b].size - asize;
+
+  if (rest < s->pol.split || rest < MINBLOCKSIZE) {
+    return NIL;
+  }
+  int32_t r = new_block(s, s->blocks[b].addr + asize, rest);
+  s->blocks[b].size = asize;
+  link_after(s, b, r);
+  return r;
+}
+
+static int32_t sim_malloc(struct sim *s, uint32_t size) {
+  uint64_t asize = block_size(size);
+  int32_t b = find_fit(s, asize);
+
+  if (b == NIL) {
+    b = extend_heap(s, asize > s->pol.chunk ? asize : s->pol.chunk);
+  }
+  delete_free(s, b);
+  s->blocks[b].alloc = 1;
+  int32_t r = split(s, b, asize);
+  if (r != NIL) {
+    insert_free(s, r);
+    if (s->pol.fit == FIT_NEXT) {
+      // as in mm.c, the next search resumes where this allocation ended
+      struct free_list *l = &s->lists[list_index(s, s->blocks[r].size)];
+      l->rover = s->blocks[r].key;
+      l->has_rover = 1;
+    }
+  }
+  return b;
+}
+
+static void sim_free(struct sim *s, int32_t b) {
+  s->blocks[b].alloc = 0;
+  coalesce(s, b);
+}
+
+static int32_t sim_realloc(struct sim *s, int32_t b, uint32_t size) {
+  uint64_t asize = block_size(size);
+  int32_t n = s->blocks[b].next;
+
+  if (asize <= s->blocks[b].size) {
+    int32_t r = split(s, b, asize);
+    if (r != NIL) {
+      coalesce(s, r);
+    }
+    return b;
+  }
+  if (n != NIL && !s->blocks[n].alloc &&
+      s->blocks[b].size + s->blocks[n].size >= asize) {
+    delete_free(s, n);
+    absorb_next(s, b);
+    int32_t r = split(s, b, asize);
+    if (r != NIL) {
+      insert_free(s, r);
+    }
+    return b;
+  }
+  int32_t nb = sim_malloc(s, size);
+  sim_free(s, b);
+  return nb;
+}
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// an empty heap of one chunk under s->pol
+static void sim_init(struct sim *s) {
+  s->blocks = NULL;
+  s->num_blocks = 0;
+  s->unused_blocks = s->top = NIL;
+  memset(s->lists, 0, sizeof(s->lists));
+  s->heap_size = s->peak_heap = HEAP_START;
+  s->stamp = s->fit_probes = s->insert_probes = 0;
+  s->objs = NULL;
+  s->seconds = 0;
+  extend_heap(s, s->pol.chunk);
+}
+
+// replay n operations that are all valid for the ids' current states
+static void sim_run(struct sim *s, const struct trace_op *ops, size_t n) {
+  double start = now_sec();
+
+  for (size_t k = 0; k < n; k++) {
+    uint32_t id = ops[k].id;
+
+    if (ops[k].op == 'a') {
+      s->objs[id] = sim_malloc(s, ops[k].size);
+    } else if (ops[k].op == 'r') {
+      s->objs[id] = sim_realloc(s, s->objs[id], ops[k].size);
+    } else {
+      sim_free(s, s->objs[id]);
+      s->objs[id] = NIL;
+    }
+  }
+  s->seconds += now_sec() - start;
+}
+
+// grow the id tables, the shared ones and each model's, to cover id
+static void track(uint32_t id, struct sim *sims, int num_sims) {
+  uint32_t cap = num_ids ? num_ids : 1024;
+
+  while (cap <= id) {
+    cap *= 2;
+  }
+  sizes = xrealloc(sizes, cap * sizeof(*sizes));
+  live_ids = xrealloc(live_ids, cap * sizeof(*live_ids));
+  memset(&sizes[num_ids], 0, (cap - num_ids) * sizeof(*sizes));
+  memset(&live_ids[num_ids], 0, (cap - num_ids) * sizeof(*live_ids));
+  for (int k = 0; k < num_sims; k++) {
+    sims[k].objs = xrealloc(sims[k].objs, cap * sizeof(int32_t));
+    for (uint32_t i = num_ids; i < cap; i++) {
+      sims[k].objs[i] = NIL;
+    }
+  }
+  num_ids = cap;
+}
+
+//
+// run - Replay the trace in f under every model and print one result line
+// for each. Returns 0 on success, -1 on a malformed trace line.
+//
+static int run(struct sim *sims, int num_sims, FILE *f) {
+  struct trace_op *ops = xrealloc(NULL, BATCH * sizeof(*ops));
+  uint64_t num_ops = 0, skipped = 0, live = 0, peak_live = 0;
+  double start = now_sec(), model = 0;
+  size_t n;
+  int rc;
+
+  do {
+    // parse a batch, dropping the ops that break the trace contract
+    for (n = 0; n < BATCH && (rc = trace_next(f, &ops[n])) == 1;) {
+      struct trace_op *op = &ops[n];
+      if (op->id >= num_ids) {
+        track(op->id, sims, num_sims);
+      }
+      if ((op->op == 'a') == live_ids[op->id]) {
+        skipped++;
+        continue;
+      }
+      live += (uint64_t)(op->op == 'f' ? 0 : op->size) - sizes[op->id];
+      sizes[op->id] = op->op == 'f' ? 0 : op->size;
+      live_ids[op->id] = op->op != 'f';
+      peak_live = live > peak_live ? live : peak_live;
+      n++;
+    }
+    for (int k = 0; k < num_sims; k++) {
+      sim_run(&sims[k], ops, n);
+    }
+    num_ops += n;
+  } while (rc == 1);
+  free(ops);
+  if (rc == -1) {
+    return -1;
+  }
+
+  for (int k = 0; k < num_sims; k++) {
+    const struct sim *s = &sims[k];
+    printf("%-40s peak heap %10llu  frag %5.1f%%  fit probes %12llu  "
+           "insert probes %12llu  %.2f Mops/s\n",
+           s->pol.spec, (unsigned long long)s->peak_heap,
+           100.0 * (1.0 - (double)peak_live / s->peak_heap),
+           (unsigned long long)s->fit_probes,
+           (unsigned long long)s->insert_probes,
+           s->seconds > 0 ? num_ops / s->seconds / 1e6 : 0);
+    model += s->seconds;
+  }
+  fprintf(stderr, "simulate: %llu ops, %.2f s reading, %.2f s modelling\n",
+          (unsigned long long)num_ops, now_sec() - start - model, model);
+  if (skipped > 0) {
+    fprintf(stderr, "simulate: skipped %llu ops on ids in the wrong state\n",
+            (unsigned long long)skipped);
+  }
+  return 0;
+}
+
+//
+// parse_policy - Fill p from a "key=value,..." spec. Returns 0 on success.
+//
+static int parse_policy(const char *spec, struct policy *p) {
+  static const uint64_t limits[NUM_FREE_LISTS - 1] = {
+      16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384};
+  char buf[256], *save, *item;
+
+  p->spec = spec;
+  p->fit = FIT_FIRST;
+  p->lifo = 0;
+  p->num_lists = NUM_FREE_LISTS;
+  memcpy(p->limits, limits, sizeof(limits));
+  p->split = MINBLOCKSIZE;
+  p->chunk = 1 << 12;
+
+  if (strlen(spec) >= sizeof(buf)) {
+    return -1;
+  }
+  strcpy(buf, spec);
+  for (item = strtok_r(buf, ",", &save); item != NULL;
+       item = strtok_r(NULL, ",", &save)) {
+    char *value = strchr(item, '=');
+    if (value == NULL) {
+      return -1;
+    }
+    *value++ = '\0';
+    if (strcmp(item, "fit") == 0) {
+      if (strcmp(value, "first") == 0) {
+        p->fit = FIT_FIRST;
+      } else if (strcmp(value, "best") == 0) {
+        p->fit = FIT_BEST;
+      } else if (strcmp(value, "next") == 0) {
+        p->fit = FIT_NEXT;
+      } else {
+        return -1;
+      }
+    } else if (strcmp(item, "order") == 0) {
+      if (strcmp(value, "addr") != 0 && strcmp(value, "lifo") != 0) {
+        return -1;
+      }
+      p->lifo = strcmp(value, "lifo") == 0;
+    } else if (strcmp(item, "classes") == 0) {
+      // "1" alone is a single list, otherwise ascending bounds
+      char *end;
+      p->num_lists = 1;
+      if (strcmp(value, "1") == 0) {
+        continue;
+      }
+      while (*value != '\0' && p->num_lists < NUM_FREE_LISTS) {
+        p->limits[p->num_lists - 1] = strtoull(value, &end, 10);
+        if (end == value) {
+          return -1;
+        }
+        p->num_lists++;
+        value = (*end == '/') ? end + 1 : end;
+      }
+      if (*value != '\0') {
+        return -1;
+      }
+    } else if (strcmp(item, "split") == 0) {
+      p->split = strtoull(value, NULL, 10);
+    } else if (strcmp(item, "chunk") == 0) {
+      p->chunk = strtoull(value, NULL, 10) & ~(uint64_t)(2 * ALIGNMENT - 1);
+      if (p->chunk < MINBLOCKSIZE) {
+        return -1;
+      }
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  static const char *defaults[] = {
+      "fit=first,order=addr", "fit=first,order=lifo", "fit=best,order=addr",
+      "fit=best,order=lifo",  "fit=next,order=addr",  "fit=next,order=lifo"};
+  const char **specs = NULL;
+  struct sim *sims;
+  int num_specs = 0, opt;
+  FILE *f;
+
+  while ((opt = getopt(argc, argv, "p:")) != -1) {
+    if (opt != 'p') {
+      break;
+    }
+    specs = xrealloc(specs, (num_specs + 1) * sizeof(*specs));
+    specs[num_specs++] = optarg;
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: %s [-p policy]... trace\n", argv[0]);
+    return 1;
+  }
+  if (num_specs == 0) {
+    specs = defaults;
+    num_specs = sizeof(defaults) / sizeof(defaults[0]);
+  }
+
+  sims = xrealloc(NULL, num_specs * sizeof(*sims));
+  for (int i = 0; i < num_specs; i++) {
+    if (parse_policy(specs[i], &sims[i].pol) == -1) {
+      fprintf(stderr, "%s: bad policy \"%s\"\n", argv[0], specs[i]);
+      return 1;
+    }
+    sim_init(&sims[i]);
+  }
+  if ((f = fopen(argv[optind], "r")) == NULL) {
+    fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind]);
+    return 1;
+  }
+  if (run(sims, num_specs, f) == -1) {
+    fprintf(stderr, "%s: malformed trace %s\n", argv[0], argv[optind]);
+    return 1;
+  }
+  fclose(f);
+  if (specs != defaults) {
+    free(specs);
+  }
+  return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * sizeclass.c - derive segregated list size classes from a workload
+ *
+ * Reads an allocation trace (see trace.h) or a histogram of "<size> <count>"
+ * lines, converts request sizes to mm.c block sizes and picks the class
+ * bounds that minimize rounding waste: the bytes each block would lose if
+ * it were rounded up to the largest block size of its class. Within a
+ * class mm.c fits first-fit, so this is also the slack a fit can leave
+ * behind. The bounds are written as a header for mm.c:
+ *
+ *   ./tools/sizeclass.out [-k classes] [-o mm_classes.h] trace.txt
+ *   make CLASSES=mm_classes.h
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// must match mm.c
+#define NUM_FREE_LISTS 12
+#define MINBLOCKSIZE 32
+#define OVERHEAD 16
+#define ALIGNMENT 8
+
+static const uint64_t default_limits[NUM_FREE_LISTS - 1] = {
+    16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384};
+
+// distinct block sizes, ascending, with their counts and prefix sums
+static uint64_t *sizes, *counts;
+static double *count_sum, *byte_sum;
+static size_t num_sizes;
+
+// dp[k][j]: least waste covering sizes[0..j] with k + 1 classes
+static double *dp_prev, *dp_cur;
+static size_t *cut_cur, **cuts;
+static size_t layer; // k of the dp layer being filled
+
+static uint64_t block_size(uint64_t size) {
+  if (size <= ALIGNMENT) {
+    return MINBLOCKSIZE;
+  }
+  return (size + OVERHEAD + ALIGNMENT - 1) & ~(uint64_t)(ALIGNMENT - 1);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+//
+// load_sizes - Collect block sizes from a trace or histogram file into the
+// sorted distinct-size tables. On failure nothing stays allocated.
+//
+static int load_sizes(const char *path) {
+  FILE *f = fopen(path, "r");
+  uint64_t *samples = NULL, *weights = NULL, *packed = NULL;
+  size_t n = 0, cap = 0;
+  char line[128];
+  int ret = -1;
+
+  if (f == NULL) {
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    unsigned long long a, b;
+    char kind;
+
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if (n == cap) {
+      cap = cap ? 2 * cap : 1024;
+      uint64_t *s = realloc(samples, cap * sizeof(*samples));
+      if (s != NULL) {
+        samples = s;
+      }
+      uint64_t *w = realloc(weights, cap * sizeof(*weights));
+      if (w != NULL) {
+        weights = w;
+      }
+      if (s == NULL || w == NULL) {
+        fprintf(stderr, "sizeclass: out of memory\n");
+        goto cleanup;
+      }
+    }
+    if (sscanf(line, " %c %llu %llu", &kind, &a, &b) == 3 &&
+        (kind == 'a' || kind == 'r')) {
+      samples[n] = block_size(b);
+      weights[n++] = 1;
+    } else if (sscanf(line, "%llu %llu", &a, &b) == 2) {
+      samples[n] = block_size(a);
+      weights[n++] = b;
+    } else if (sscanf(line, " %c", &kind) != 1 || kind != 'f') {
+      goto cleanup;
+    }
+  }
+  fclose(f);
+  f = NULL;
+  if (n == 0) {
+    goto cleanup;
+  }
+
+  // sort (size, weight) pairs by size via an index, then merge duplicates
+  packed = malloc(n * 2 * sizeof(uint64_t));
+  sizes = malloc(n * sizeof(*sizes));
+  counts = malloc(n * sizeof(*counts));
+  if (packed == NULL || sizes == NULL || counts == NULL) {
+    fprintf(stderr, "sizeclass: out of memory\n");
+    goto cleanup;
+  }
+  for (size_t i = 0; i < n; i++) {
+    packed[2 * i] = samples[i];
+    packed[2 * i + 1] = weights[i];
+  }
+  qsort(packed, n, 2 * sizeof(uint64_t), cmp_u64);
+
+  num_sizes = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (num_sizes > 0 && sizes[num_sizes - 1] == packed[2 * i]) {
+      counts[num_sizes - 1] += packed[2 * i + 1];
+    } else {
+      sizes[num_sizes] = packed[2 * i];
+      counts[num_sizes++] = packed[2 * i + 1];
+    }
+  }
+
+  count_sum = calloc(num_sizes + 1, sizeof(*count_sum));
+  byte_sum = calloc(num_sizes + 1, sizeof(*byte_sum));
+  if (count_sum == NULL || byte_sum == NULL) {
+    fprintf(stderr, "sizeclass: out of memory\n");
+    goto cleanup;
+  }
+  for (size_t i = 0; i < num_sizes; i++) {
+    count_sum[i + 1] = count_sum[i] + (double)counts[i];
+    byte_sum[i + 1] = byte_sum[i] + (double)counts[i] * (double)sizes[i];
+  }
+  ret = 0;
+
+cleanup:
+  if (f != NULL) {
+    fclose(f);
+  }
+  free(packed);
+  free(samples);
+  free(weights);
+  if (ret == -1) {
+    free(sizes);
+    free(counts);
+    free(count_sum);
+    free(byte_sum);
+    sizes = counts = NULL;
+    count_sum = byte_sum = NULL;
+    num_sizes = 0;
+  }
+  return ret;
+}
+
+// waste of one class holding sizes[i..j], rounded up to sizes[j]
+static double class_waste(size_t i, size_t j) {
+  return (double)sizes[j] * (count_sum[j + 1] - count_sum[i]) -
+         (byte_sum[j + 1] - byte_sum[i]);
+}
+
+//
+// solve_range - Divide-and-conquer step for one dp layer: fill dp_cur[lo..hi]
+// knowing the best cut for each lies in [cut_lo, cut_hi]. The waste is
+// monotone in the cut, so the optimal cut is non-decreasing in j.
+//
+static void solve_range(size_t lo, size_t hi, size_t cut_lo, size_t cut_hi) {
+  if (lo > hi) {
+    return;
+  }
+  size_t mid = lo + (hi - lo) / 2;
+  size_t best_cut = cut_lo > layer ? cut_lo : layer;
+  double best = HUGE_VAL;
+
+  // the last class is sizes[cut..mid] and sizes[0..cut-1] needs at least
+  // one size for each of the other layer classes
+  for (size_t cut = best_cut; cut <= cut_hi && cut <= mid; cut++) {
+    double w = dp_prev[cut - 1] + class_waste(cut, mid);
+    if (w < best) {
+      best = w;
+      best_cut = cut;
+    }
+  }
+  dp_cur[mid] = best;
+  cut_cur[mid] = best_cut;
+  if (mid > lo) {
+    solve_range(lo, mid - 1, cut_lo, best_cut);
+  }
+  solve_range(mid + 1, hi, best_cut, cut_hi);
+}
+
+//
+// derive_limits - Optimal bounds for up to num_classes classes; the last
+// class is open-ended. Returns the number of bounds written, or -1 if out
+// of memory.
+//
+static int derive_limits(int num_classes, uint64_t *limits) {
+  int k, layers = num_classes, written = -1;
+
+  if ((size_t)layers > num_sizes) {
+    layers = (int)num_sizes;
+  }
+  dp_prev = malloc(num_sizes * sizeof(double));
+  dp_cur = malloc(num_sizes * sizeof(double));
+  cuts = calloc(layers, sizeof(*cuts));
+  for (k = 1; cuts != NULL && k < layers; k++) {
+    if ((cuts[k] = malloc(num_sizes * sizeof(size_t))) == NULL) {
+      break;
+    }
+  }
+  if (dp_prev == NULL || dp_cur == NULL || cuts == NULL || k < layers) {
+    fprintf(stderr, "sizeclass: out of memory\n");
+  } else {
+    for (size_t j = 0; j < num_sizes; j++) {
+      dp_prev[j] = class_waste(0, j);
+    }
+    for (k = 1; k < layers; k++) {
+      layer = (size_t)k;
+      cut_cur = cuts[k];
+      solve_range(0, num_sizes - 1, 0, num_sizes - 1);
+      double *t = dp_prev;
+      dp_prev = dp_cur;
+      dp_cur = t;
+    }
+
+    // walk the cuts back from the last size
+    size_t j = num_sizes - 1;
+    for (k = layers - 1; k > 0; k--) {
+      size_t cut = cuts[k][j];
+      limits[k - 1] = sizes[cut - 1];
+      j = cut - 1;
+    }
+    written = layers - 1;
+  }
+
+  for (k = 1; cuts != NULL && k < layers; k++) {
+    free(cuts[k]);
+  }
+  free(cuts);
+  free(dp_prev);
+  free(dp_cur);
+  return written;
+}
+
+// class index of a block size under the given bounds
+static int class_of(uint64_t size, const uint64_t *limits, int num_limits) {
+  int c = 0;
+
+  while (c < num_limits && size > limits[c]) {
+    c++;
+  }
+  return c;
+}
+
+// waste of the workload under the given bounds, last class open-ended
+static double total_waste(const uint64_t *limits, int num_limits) {
+  double waste = 0;
+  size_t i = 0;
+
+  while (i < num_sizes) {
+    int c = class_of(sizes[i], limits, num_limits);
+    size_t j = i;
+    while (j + 1 < num_sizes &&
+           class_of(sizes[j + 1], limits, num_limits) == c) {
+      j++;
+    }
+    waste += class_waste(i, j);
+    i = j + 1;
+  }
+  return waste;
+}
+
+int main(int argc, char **argv) {
+  uint64_t limits[NUM_FREE_LISTS - 1];
+  int num_classes = NUM_FREE_LISTS, num_limits, opt;
+  const char *out_path = NULL;
+  FILE *out = stdout;
+
+  while ((opt = getopt(argc, argv, "k:o:")) != -1) {
+    if (opt == 'k') {
+      num_classes = atoi(optarg);
+    } else if (opt == 'o') {
+      out_path = optarg;
+    } else {
+      break;
+    }
+  }
+  if (optind != argc - 1 || num_classes < 2 || num_classes > NUM_FREE_LISTS) {
+    fprintf(stderr, "usage: %s [-k 2..%d] [-o header] trace-or-histogram\n",
+            argv[0], NUM_FREE_LISTS);
+    return 1;
+  }
+  if (load_sizes(argv[optind]) == -1) {
+    fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind]);
+    return 1;
+  }
+
+  if ((num_limits = derive_limits(num_classes, limits)) == -1) {
+    return 1;
+  }
+  double total = byte_sum[num_sizes];
+  double before = total_waste(default_limits, NUM_FREE_LISTS - 1);
+  double after = total_waste(limits, num_limits);
+  fprintf(stderr, "%zu distinct block sizes, %.0f blocks\n", num_sizes,
+          count_sum[num_sizes]);
+  fprintf(stderr, "rounding waste: default %.1f%%, derived %.1f%%\n",
+          100 * before / (total + before), 100 * after / (total + after));
+
+  if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+    fprintf(stderr, "%s: cannot write %s\n", argv[0], out_path);
+    return 1;
+  }
+  fprintf(out, "/* generated by tools/sizeclass.out from %s */\n",
+          argv[optind]);
+  fprintf(out, "#define MM_CLASS_LIMITS \\\n  {");
+  for (int i = 0; i < NUM_FREE_LISTS - 1; i++) {
+    if (i < num_limits) {
+      fprintf(out, "%s%llu", i ? ", " : "", (unsigned long long)limits[i]);
+    } else {
+      fprintf(out, "%sSIZE_MAX", i ? ", " : "");
+    }
+  }
+  fprintf(out, "}\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * trace.c - reader for the allocation trace format described in trace.h
+ */
+#include "trace.h"
+#include <stdlib.h>
+
+//
+// trace_next - Read the next operation. Returns 1 on success, 0 at end of
+// file, -1 on a malformed line.
+//
+int trace_next(FILE *f, struct trace_op *op) {
+  char line[128];
+
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char kind;
+    unsigned long id, size = 0;
+    int n;
+
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    n = sscanf(line, " %c %lu %lu", &kind, &id, &size);
+    if (n < 2 || id > UINT32_MAX || size > UINT32_MAX ||
+        ((kind == 'a' || kind == 'r') && n != 3) ||
+        (kind != 'a' && kind != 'r' && kind != 'f')) {
+      return -1;
+    }
+    op->op = kind;
+    op->id = (uint32_t)id;
+    op->size = (uint32_t)size;
+    return 1;
+  }
+  return 0;
+}
+
+//
+// trace_load - Read a whole trace into memory. Returns 0 on success.
+//
+int trace_load(const char *path, struct trace *t) {
+  FILE *f = fopen(path, "r");
+  size_t cap = 1024;
+  struct trace_op op;
+  int status = 0;
+
+  if (f == NULL) {
+    return -1;
+  }
+  t->ops = malloc(cap * sizeof(*t->ops));
+  t->num_ops = 0;
+  t->num_ids = 0;
+  while (t->ops != NULL && (status = trace_next(f, &op)) == 1) {
+    if (t->num_ops == cap) {
+      struct trace_op *ops = realloc(t->ops, 2 * cap * sizeof(*t->ops));
+      if (ops == NULL) {
+        break;
+      }
+      t->ops = ops;
+      cap *= 2;
+    }
+    t->ops[t->num_ops++] = op;
+    if (op.id >= t->num_ids) {
+      t->num_ids = op.id + 1;
+    }
+  }
+  fclose(f);
+  if (t->ops == NULL || status != 0) {
+    trace_free(t);
+    return -1;
+  }
+  return 0;
+}
+
+void trace_free(struct trace *t) {
+  free(t->ops);
+  t->ops = NULL;
+  t->num_ops = 0;
+}
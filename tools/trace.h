@@ -0,0 +1,29 @@
+#include <stdint.h>
+#include <stdio.h>
+
+//
+// Allocation traces, one operation per line:
+//
+//   a <id> <size>    allocate size bytes as object id
+//   r <id> <size>    reallocate object id to size bytes
+//   f <id>           free object id
+//
+// Blank lines and lines starting with '#' are ignored. Ids are small
+// non-negative integers chosen by the recorder and may be reused after
+// the object they named is freed.
+//
+struct trace_op {
+  char op;       // 'a', 'r' or 'f'
+  uint32_t id;   // object id
+  uint32_t size; // requested bytes, 0 for 'f'
+};
+
+struct trace {
+  struct trace_op *ops;
+  size_t num_ops;
+  uint32_t num_ids; // one more than the largest id
+};
+
+extern int trace_next(FILE *f, struct trace_op *op);
+extern int trace_load(const char *path, struct trace *t);
+extern void trace_free(struct trace *t);